@@ -0,0 +1,164 @@
+#ifndef MUSE_ARMCL_BINARY_IO_HPP
+#define MUSE_ARMCL_BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace muse_armcl {
+/**
+ * @brief Bounds checked cursor over a memory block, values are copied out so
+ *        the block needs no alignment.
+ */
+class BinaryReader
+{
+public:
+    inline BinaryReader(const char *data, const std::size_t size) :
+        data_(data),
+        end_(data + size)
+    {
+    }
+
+    template <typename T>
+    inline bool read(T &value)
+    {
+        return read(&value, 1);
+    }
+
+    template <typename T>
+    inline bool read(T *values, const std::size_t n)
+    {
+        const std::size_t bytes = n * sizeof(T);
+        if (static_cast<std::size_t>(end_ - data_) < bytes)
+            return false;
+        std::memcpy(values, data_, bytes);
+        data_ += bytes;
+        return true;
+    }
+
+    template <typename T>
+    inline bool read(std::vector<T> &values, const std::size_t n)
+    {
+        if (static_cast<std::size_t>(end_ - data_) / sizeof(T) < n)
+            return false;
+        values.resize(n);
+        return read(values.data(), n);
+    }
+
+    inline bool read(std::string &s)
+    {
+        uint64_t size;
+        if (!read(size) || static_cast<std::size_t>(end_ - data_) < size)
+            return false;
+        s.assign(data_, size);
+        data_ += size;
+        return true;
+    }
+
+    /// bytes left, e.g. to check a count before allocating for it
+    inline std::size_t remaining() const
+    {
+        return static_cast<std::size_t>(end_ - data_);
+    }
+
+private:
+    const char *data_;
+    const char *end_;
+};
+
+class BinaryWriter
+{
+public:
+    inline explicit BinaryWriter(std::ofstream &out) :
+        out_(out)
+    {
+    }
+
+    template <typename T>
+    inline void write(const T &value)
+    {
+        write(&value, 1);
+    }
+
+    template <typename T>
+    inline void write(const T *values, const std::size_t n)
+    {
+        out_.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(n * sizeof(T)));
+    }
+
+    template <typename T>
+    inline void write(const std::vector<T> &values)
+    {
+        write(values.data(), values.size());
+    }
+
+    inline void write(const std::string &s)
+    {
+        write(static_cast<uint64_t>(s.size()));
+        out_.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+private:
+    std::ofstream &out_;
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file, unmapped on destruction.
+ */
+class MappedFile
+{
+public:
+    inline explicit MappedFile(const std::string &file)
+    {
+        const int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *mapped = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data_ = static_cast<const char*>(mapped);
+                size_ = static_cast<std::size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    inline ~MappedFile()
+    {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile& operator = (const MappedFile &other) = delete;
+
+    inline bool valid() const
+    {
+        return data_ != nullptr;
+    }
+
+    inline const char* data() const
+    {
+        return data_;
+    }
+
+    inline std::size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char  *data_ = nullptr;
+    std::size_t  size_ = 0;
+};
+}
+
+#endif // MUSE_ARMCL_BINARY_IO_HPP
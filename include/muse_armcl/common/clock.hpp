@@ -0,0 +1,60 @@
+#ifndef MUSE_ARMCL_CLOCK_HPP
+#define MUSE_ARMCL_CLOCK_HPP
+
+#include <cslibs_time/time.hpp>
+#include <ros/ros.h>
+
+namespace muse_armcl {
+/**
+ * @brief Time source for time driven decisions of the filter plugins.
+ *        In wall time mode now() is the ROS time, in data time mode it is the
+ *        latest data stamp observed, so recorded data can be replayed at any
+ *        speed with the same results.
+ */
+class Clock
+{
+public:
+    using time_t = cslibs_time::Time;
+
+    inline explicit Clock(const bool use_data_time = false) :
+        use_data_time_(use_data_time)
+    {
+    }
+
+    /// reads the toplevel parameter use_data_time
+    inline void setup(ros::NodeHandle &nh)
+    {
+        use_data_time_ = nh.param<bool>("use_data_time", false);
+    }
+
+    inline bool useDataTime() const
+    {
+        return use_data_time_;
+    }
+
+    /// advance data time, stamps older than the latest one are ignored
+    inline void observe(const time_t &stamp)
+    {
+        if (latest_ < stamp)
+            latest_ = stamp;
+    }
+
+    inline time_t now() const
+    {
+        return use_data_time_ ? latest_ : time_t(ros::Time::now().toNSec());
+    }
+
+    /// observe a stamp and return the current time
+    inline time_t now(const time_t &stamp)
+    {
+        observe(stamp);
+        return now();
+    }
+
+private:
+    bool   use_data_time_;
+    time_t latest_;
+};
+}
+
+#endif // MUSE_ARMCL_CLOCK_HPP
@@ -0,0 +1,120 @@
+#ifndef MUSE_ARMCL_THREAD_POOL_HPP
+#define MUSE_ARMCL_THREAD_POOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <memory>
+
+namespace muse_armcl {
+/**
+ * @brief Small fixed size worker pool. run() distributes the indices of a job
+ *        over the workers and the calling thread and blocks until all are done.
+ */
+class ThreadPool
+{
+public:
+    using Ptr   = std::shared_ptr<ThreadPool>;
+    using job_t = std::function<void(const std::size_t)>;
+
+    /// 0 threads uses the hardware concurrency, 1 runs everything on the caller
+    inline explicit ThreadPool(std::size_t threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 1 ; i < threads ; ++i)
+            workers_.emplace_back(&ThreadPool::loop, this);
+    }
+
+    inline virtual ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+        for (std::thread &w : workers_)
+            w.join();
+    }
+
+    inline std::size_t size() const
+    {
+        return workers_.size() + 1;
+    }
+
+    /// call job(i) for every i in [0, n), the first exception thrown is passed on
+    inline void run(const std::size_t n, const job_t &job)
+    {
+        if (n == 0)
+            return;
+
+        std::unique_lock<std::mutex> l(mutex_);
+        job_       = &job;
+        n_         = n;
+        next_      = 0;
+        remaining_ = n;
+        error_     = nullptr;
+        ++generation_;
+        work_.notify_all();
+
+        drain(l, generation_);
+        done_.wait(l, [this]{return remaining_ == 0;});
+        job_ = nullptr;
+
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex               mutex_;
+    std::condition_variable  work_;
+    std::condition_variable  done_;
+    const job_t             *job_       = nullptr;
+    std::size_t              n_         = 0;
+    std::size_t              next_      = 0;
+    std::size_t              remaining_ = 0;
+    std::size_t              generation_ = 0;
+    std::exception_ptr       error_;
+    bool                     stop_      = false;
+
+    inline void loop()
+    {
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> l(mutex_);
+        while (true) {
+            work_.wait(l, [this, &seen]{return stop_ || generation_ != seen;});
+            if (stop_)
+                return;
+            seen = generation_;
+            drain(l, seen);
+        }
+    }
+
+    /// indices are handed out under the lock, so a late worker never runs a stale job
+    inline void drain(std::unique_lock<std::mutex> &l, const std::size_t generation)
+    {
+        while (generation == generation_ && job_ && next_ < n_) {
+            const std::size_t i   = next_++;
+            const job_t      &job = *job_;
+            l.unlock();
+            std::exception_ptr error;
+            try {
+                job(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            l.lock();
+            if (error && !error_)
+                error_ = error;
+            if (--remaining_ == 0)
+                done_.notify_all();
+        }
+    }
+};
+}
+
+#endif // MUSE_ARMCL_THREAD_POOL_HPP
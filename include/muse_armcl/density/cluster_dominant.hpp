@@ -19,7 +19,6 @@ struct EIGEN_ALIGN16 ClusterDominant
     using data_t              = ClusterData;
     using sample_t            = StateSpaceDescription::sample_t;
     using sample_map_t        = std::unordered_map<int, const sample_t*>;
-    using sample_map_ranked_t = std::map<double, std::vector<const sample_t*>>;
 
     ClusterDominant(double threshold = 0.1) :
         clustering_weight_threshold_percentage(threshold)
@@ -40,7 +39,7 @@ struct EIGEN_ALIGN16 ClusterDominant
     /// called when a new cluster should be started
     bool start(const index_t&, data_t& data)
     {
-        if (data.cluster != -1)
+        if (data.cluster != -1 || data.samples.empty())
             return false;
 
         ++current_cluster;
@@ -58,7 +57,7 @@ struct EIGEN_ALIGN16 ClusterDominant
     /// called when a cluster is extended due to found neighbors
     bool extend(const index_t&, const index_t&, data_t& data)
     {
-        if (data.cluster != -1)
+        if (data.cluster != -1 || data.samples.empty())
             return false;
 
         data.cluster = current_cluster;
@@ -84,15 +83,13 @@ struct EIGEN_ALIGN16 ClusterDominant
         neighborhood.visit(visitior);
     }
 
-    /// get cluster samples
-    inline sample_map_ranked_t getSamples() const
+    /// rank cluster samples by weight, ties by likelihood
+    template <typename top_k_t>
+    inline void getSamples(top_k_t &top_k) const
     {
-        sample_map_ranked_t map;
-
         for (auto &d : dominants) {
-            map[d.second->weight].emplace_back(d.second);
+            top_k.push(d.second->weight, d.second->state.last_update, d.second);
         }
-        return map;
     }
 
     int current_cluster = -1;   /// keep track of the current cluster index
@@ -21,7 +21,6 @@ struct EIGEN_ALIGN16 ClusterWeightedDistribution
     using data_t              = ClusterData;
     using sample_t            = ClusterData::sample_t;
     using sample_map_t        = std::unordered_map<int, const sample_t*>;
-    using sample_map_ranked_t = std::map<double, std::vector<const sample_t*>>;
     using sample_vector_t     = ClusterData::sample_vector_t;
     using sample_vector_map_t = std::unordered_map<int,
                                                    sample_vector_t,
@@ -55,7 +54,7 @@ struct EIGEN_ALIGN16 ClusterWeightedDistribution
     /// called when a new cluster should be started
     bool start(const index_t&, data_t& data)
     {
-        if (data.cluster != -1)
+        if (data.cluster != -1 || data.samples.empty())
             return false;
 
         current_cluster += 1;
@@ -74,7 +73,7 @@ struct EIGEN_ALIGN16 ClusterWeightedDistribution
     /// called when a cluster is extended due to found neighbors
     bool extend(const index_t&, const index_t&, data_t& data)
     {
-        if (data.cluster != -1)
+        if (data.cluster != -1 || data.samples.empty())
             return false;
 
         data.cluster = current_cluster;
@@ -103,11 +102,10 @@ struct EIGEN_ALIGN16 ClusterWeightedDistribution
         neighborhood.visit(visitior);
     }
 
-    /// get cluster sample
-    inline sample_map_ranked_t getSamples() const
+    /// rank cluster samples by cluster weight, ties by likelihood
+    template <typename top_k_t>
+    inline void getSamples(top_k_t &top_k) const
     {
-        sample_map_ranked_t map;
-
         for (auto &d : distributions) {
             const int cluster = d.first;
             const auto m = d.second.getMean();
@@ -132,11 +130,10 @@ struct EIGEN_ALIGN16 ClusterWeightedDistribution
             }
 
             if(weight_sum > clustering_weight_threshold){
-                map[weight_sum].emplace_back(res);
+                top_k.push(weight_sum, res->state.last_update, res);
             }
 
         }
-        return map;
     }
 
     int current_cluster = -1;   /// keep track of the current cluster index
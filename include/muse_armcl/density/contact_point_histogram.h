@@ -1,6 +1,8 @@
 #ifndef CONTACT_POINT_HISTOGRAM_H
 #define CONTACT_POINT_HISTOGRAM_H
 #include <muse_armcl/density/sample_density.hpp>
+#include <muse_armcl/density/top_k.hpp>
+#include <muse_armcl/density/sample_slots.hpp>
 
 #include <unordered_map>
 #include <cslibs_math/statistics/weighted_distribution.hpp>
@@ -21,11 +23,14 @@ public:
     {
         DiscreteCluster() :
             hits(0),
-            dist(std::numeric_limits<double>::max())
+            dist(std::numeric_limits<double>::max()),
+            sample(nullptr),
+            members(0)
         {}
         double hits;
         double dist;
         sample_t const* sample;
+        std::size_t members;
     };
 
     struct DiscreteContactPoint
@@ -56,7 +61,7 @@ public:
     void setup(const map_provider_map_t &map_providers,
                ros::NodeHandle &nh) override;
 
-    void contacts(sample_vector_t &states) const override;
+    void contacts(sample_ptr_vector_t &states) const override;
 
     void getTopLabels(std::vector<std::pair<int,double>>& labels) const;
     void clear() override;
@@ -69,7 +74,29 @@ protected:
     std::map<std::string, std::vector<DiscreteContactPoint>> labeled_contact_points_;
     histogram_t                                              histo_;
     MeshMapProvider::Ptr                                     map_provider_;
-    std::map<double, std::vector<int>>                       ranked_labels_;
+    mutable TopK<const histogram_t::value_type*>             top_k_;
+
+    /// incremental mode, label assignment of every sample from the last pass
+    struct SlotEntry
+    {
+        SampleKey       key;
+        sample_t const* sample  = nullptr;
+        int             label   = -1;
+        double          dist    = 0.0;
+        double          hits    = 0.0;
+        bool            counted = false;
+    };
+
+    bool                                                     incremental_;
+    SampleSlots<SlotEntry>                                   slots_;
+    std::vector<int>                                         dirty_labels_;
+
+    void rankLabels() const;
+    bool assignLabel(const sample_t &sample, int &label, double &dist) const;
+    void addHit(const sample_t &sample, const int label, const double dist, const double hits);
+    void removeHit(const SlotEntry &entry);
+    void insertIncremental(const sample_t &sample);
+    void settle();
 
 };
 }
@@ -18,14 +18,27 @@ public:
 
     void setup(const map_provider_map_t &map_providers,
                ros::NodeHandle &nh) override;
+    void clear() override;
     void insert(const sample_t &sample) override;
 protected:
+    /// labelled points of one link group in base frame, packed as px py pz dx dy dz
+    struct LabelGroup
+    {
+        std::vector<double> points;
+        std::vector<int>    labels;
+        std::string         missing;    /// search link without labels, reported on use
+    };
+
     bool restrict_neigbours_;
     double scale_pos_;
     double scale_dir_;
     std::map<std::string, std::vector<std::string>> search_links_;
+    std::vector<LabelGroup> label_groups_;      /// indexed by map id
+    bool                    label_groups_valid_ = false;
+    KinematicSnapshot::ConstPtr kinematics_;
 
     void setupSearchLinks();
+    void updateLabelGroups(const cslibs_mesh_map::MeshMapTree &map);
 };
 }
 #endif // CONTACT_POINT_HISTOGRAM_MIN_H
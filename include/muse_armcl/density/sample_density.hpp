@@ -19,6 +19,7 @@ public:
     using ConstPtr           = std::shared_ptr<SampleDensity const>;
     using sample_t           = StateSpaceDescription::sample_t;
     using sample_vector_t    = std::vector<sample_t, sample_t::allocator_t>;
+    using sample_ptr_vector_t = std::vector<const sample_t*>;
     using map_provider_map_t = std::map<std::string, MeshMapProvider::Ptr>;
 
     inline const static std::string Type()
@@ -29,7 +30,43 @@ public:
     virtual void setup(const map_provider_map_t &map_providers,
                        ros::NodeHandle &nh) = 0;
     virtual std::size_t histogramSize() const = 0;
-    virtual void contacts(sample_vector_t &states) const = 0;
+
+    /// in lazy mode the estimation is deferred until a consumer asks for contacts
+    virtual void estimate() override
+    {
+        dirty_ = true;
+        if (!lazy_)
+            ensureEstimated();
+    }
+    /// best contacts first, pointers stay valid until the next clear()
+    virtual void contacts(sample_ptr_vector_t &states) const = 0;
+
+    inline void contacts(sample_vector_t &states) const
+    {
+        sample_ptr_vector_t ptrs;
+        contacts(ptrs);
+        states.clear();
+        states.reserve(ptrs.size());
+        for (const sample_t *s : ptrs)
+            states.emplace_back(*s);
+    }
+
+protected:
+    bool         lazy_  = true;
+    mutable bool dirty_ = false;
+
+    virtual void doEstimate()
+    {
+    }
+
+    /// run a pending estimation, results stay valid until the next clear()
+    inline void ensureEstimated() const
+    {
+        if (dirty_) {
+            dirty_ = false;
+            const_cast<SampleDensity*>(this)->doEstimate();
+        }
+    }
 };
 }
 
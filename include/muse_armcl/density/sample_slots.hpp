@@ -0,0 +1,154 @@
+#ifndef MUSE_ARMCL_SAMPLE_SLOTS_HPP
+#define MUSE_ARMCL_SAMPLE_SLOTS_HPP
+
+#include <muse_armcl/state_space/state_space_description.hpp>
+
+#include <vector>
+
+namespace muse_armcl {
+/**
+ * @brief Per sample bookkeeping that survives between two density passes.
+ *        Samples are addressed by their offset inside the sample set. If the set
+ *        moved in memory, i.e. it was resampled, all slots are dropped and the
+ *        density has to be rebuilt from scratch.
+ */
+template <typename entry_t>
+class SampleSlots
+{
+public:
+    using sample_t = StateSpaceDescription::sample_t;
+
+    /// start a new pass, to be called from clear()
+    inline void begin()
+    {
+        /// a pass that was never settled leaves untracked contributions behind
+        invalid_        = invalid_ || !settled_;
+        settled_        = false;
+        previous_base_  = base_;
+        previous_count_ = count_;
+        previous_live_  = live_;
+        base_           = nullptr;
+        count_          = 0;
+        live_           = 0;
+        known_          = 0;
+        ++generation_;
+    }
+
+    /// true until the first sample of the pass was addressed
+    inline bool opening() const
+    {
+        return base_ == nullptr;
+    }
+
+    /// address the first sample of a pass, returns true if the set was rebuilt
+    inline bool open(const sample_t &first)
+    {
+        base_ = &first;
+        const bool rebuilt = invalid_ || base_ != previous_base_;
+        if (rebuilt) {
+            previous_count_ = 0;
+            previous_live_  = 0;
+            for (slot_t &s : slots_)
+                s.generation = 0;
+        }
+        invalid_ = false;
+        return rebuilt;
+    }
+
+    /// slot of a sample, known is set if it was filled by the previous pass
+    inline entry_t* get(const sample_t &sample, bool &known)
+    {
+        known = false;
+        if (&sample < base_) {
+            /// cannot be tracked, force a rebuild on the next pass
+            invalid_ = true;
+            return nullptr;
+        }
+        const std::size_t i = static_cast<std::size_t>(&sample - base_);
+        if (i >= slots_.size())
+            slots_.resize(i + 1);
+
+        slot_t &s = slots_[i];
+        known = s.generation != 0 && s.generation + 1 == generation_;
+        s.generation = generation_;
+        count_ = std::max(count_, i + 1);
+        ++live_;
+        known_ += known ? 1 : 0;
+        return &s.entry;
+    }
+
+    /// entries filled in the previous pass which were not addressed in this one,
+    /// to be called once per pass from estimate()
+    template <typename fn_t>
+    inline void stale(const fn_t &fn)
+    {
+        settled_ = true;
+        if (known_ == previous_live_)
+            return;
+        const std::size_t n = std::min(previous_count_, slots_.size());
+        for (std::size_t i = 0 ; i < n ; ++i) {
+            slot_t &s = slots_[i];
+            if (s.generation != 0 && s.generation + 1 == generation_) {
+                fn(s.entry);
+                s.generation = 0;
+            }
+        }
+    }
+
+    /// entries addressed in the current pass
+    template <typename fn_t>
+    inline void current(const fn_t &fn)
+    {
+        for (std::size_t i = 0 ; i < count_ ; ++i) {
+            slot_t &s = slots_[i];
+            if (s.generation == generation_)
+                fn(s.entry);
+        }
+    }
+
+private:
+    struct slot_t
+    {
+        entry_t     entry;
+        std::size_t generation = 0;
+    };
+
+    std::vector<slot_t> slots_;
+    const sample_t     *base_           = nullptr;
+    const sample_t     *previous_base_  = nullptr;
+    std::size_t         count_          = 0;
+    std::size_t         previous_count_ = 0;
+    std::size_t         live_           = 0;
+    std::size_t         previous_live_  = 0;
+    std::size_t         known_          = 0;
+    std::size_t         generation_     = 1;
+    bool                invalid_        = false;
+    bool                settled_        = true;
+};
+
+/// state key deciding whether a sample moved since the last pass
+struct SampleKey
+{
+    inline SampleKey() = default;
+    inline SampleKey(const StateSpaceDescription::state_t &state) :
+        map_id(state.map_id),
+        active(state.active_vertex.idx()),
+        goal(state.goal_vertex.idx()),
+        s(state.s)
+    {
+    }
+
+    inline bool operator == (const SampleKey &other) const
+    {
+        return map_id == other.map_id && active == other.active &&
+               goal == other.goal && s == other.s;
+    }
+
+    std::size_t map_id = 0;
+    int         active = -1;
+    int         goal   = -1;
+    double      s      = -1.0;
+};
+}
+
+#endif // MUSE_ARMCL_SAMPLE_SLOTS_HPP
@@ -0,0 +1,90 @@
+#ifndef MUSE_ARMCL_TOP_K_HPP
+#define MUSE_ARMCL_TOP_K_HPP
+
+#include <vector>
+#include <algorithm>
+
+namespace muse_armcl {
+/**
+ * @brief Bounded top-k selection over (score, tie-break) pairs.
+ *        Higher score wins, equal scores are decided by the higher tie-break value
+ *        and finally by insertion order. The heap keeps its capacity between
+ *        reset() calls, so repeated extraction does not allocate.
+ */
+template <typename value_t>
+class TopK
+{
+public:
+    struct Entry
+    {
+        double      score;
+        double      tie;
+        std::size_t order;
+        value_t     value;
+    };
+    using entry_vector_t = std::vector<Entry>;
+
+    TopK(const std::size_t k = 0)
+    {
+        reset(k);
+    }
+
+    inline void reset(const std::size_t k)
+    {
+        k_     = k;
+        order_ = 0;
+        heap_.clear();
+        heap_.reserve(k);
+    }
+
+    inline void push(const double score, const double tie, const value_t &value)
+    {
+        if (k_ == 0)
+            return;
+
+        const Entry e{score, tie, order_++, value};
+        if (heap_.size() < k_) {
+            heap_.emplace_back(e);
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        } else if (better(e, heap_.front())) {
+            /// front is the worst element currently kept
+            std::pop_heap(heap_.begin(), heap_.end(), better);
+            heap_.back() = e;
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        }
+    }
+
+    /// best entry first, the heap has to be reset before pushing again
+    inline const entry_vector_t& sorted()
+    {
+        std::sort_heap(heap_.begin(), heap_.end(), better);
+        return heap_;
+    }
+
+    inline std::size_t size() const
+    {
+        return heap_.size();
+    }
+
+    inline std::size_t capacity() const
+    {
+        return k_;
+    }
+
+private:
+    std::size_t    k_;
+    std::size_t    order_;
+    entry_vector_t heap_;
+
+    static inline bool better(const Entry &a, const Entry &b)
+    {
+        if (a.score != b.score)
+            return a.score > b.score;
+        if (a.tie != b.tie)
+            return a.tie > b.tie;
+        return a.order < b.order;
+    }
+};
+}
+
+#endif // MUSE_ARMCL_TOP_K_HPP
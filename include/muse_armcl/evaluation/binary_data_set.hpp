@@ -0,0 +1,346 @@
+#ifndef BINARY_DATA_SET_HPP
+#define BINARY_DATA_SET_HPP
+#include <muse_armcl/evaluation/contact_evaluation_data.hpp>
+#include <muse_armcl/common/binary_io.hpp>
+
+#include <tf/tfMessage.h>
+#include <jaco2_contact_msgs/Jaco2CollisionSequence.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+namespace muse_armcl {
+namespace BinaryDataSetFormat {
+const char     MAGIC[8] = {'M', 'A', 'R', 'M', 'C', 'L', 'D', 'S'};
+const uint32_t VERSION  = 1;
+
+struct Header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t n_sequences;
+    uint64_t index_offset;   /// file offset of the sequence offsets, written last
+    uint64_t n_samples;
+};
+}
+
+/**
+ * @brief Writes sequences one by one, the index is appended by close().
+ */
+class BinaryDataSetWriter
+{
+public:
+    using Ptr = std::shared_ptr<BinaryDataSetWriter>;
+
+    explicit BinaryDataSetWriter(const std::string &file) :
+        out_(file, std::ios::binary | std::ios::trunc),
+        w_(out_),
+        n_samples_(0)
+    {
+        BinaryDataSetFormat::Header h;
+        std::memset(&h, 0, sizeof(h));
+        w_.write(h);
+    }
+
+    bool good() const
+    {
+        return out_.good();
+    }
+
+    /// one sequence, either message may be missing
+    bool write(const uint64_t                                   bag_time,
+               const tf::tfMessage                             *tf,
+               const jaco2_contact_msgs::Jaco2CollisionSequence *sequence)
+    {
+        /// every row of a sequence has the same number of joints
+        if (sequence && !sequence->data.empty()) {
+            for (const jaco2_contact_msgs::Jaco2CollisionSample &s : sequence->data) {
+                if (s.state.name.size() != sequence->data.front().state.name.size()) {
+                    std::cerr << "[BinaryDataSetWriter]: joint count changes within a sequence!" << std::endl;
+                    return false;
+                }
+            }
+        }
+
+        offsets_.emplace_back(static_cast<uint64_t>(out_.tellp()));
+        w_.write(bag_time);
+        w_.write(static_cast<uint8_t>(tf ? 1 : 0));
+        w_.write(static_cast<uint8_t>(sequence ? 1 : 0));
+
+        if (tf) {
+            const std::size_t n = tf->transforms.size();
+            std::vector<uint64_t> stamps(n);
+            std::vector<double>   translations(3 * n);
+            std::vector<double>   rotations(4 * n);
+            w_.write(static_cast<uint64_t>(n));
+            for (std::size_t i = 0 ; i < n ; ++i) {
+                const geometry_msgs::TransformStamped &t = tf->transforms[i];
+                w_.write(t.header.frame_id);
+                w_.write(t.child_frame_id);
+                stamps[i] = t.header.stamp.toNSec();
+                translations[3 * i]     = t.transform.translation.x;
+                translations[3 * i + 1] = t.transform.translation.y;
+                translations[3 * i + 2] = t.transform.translation.z;
+                rotations[4 * i]        = t.transform.rotation.x;
+                rotations[4 * i + 1]    = t.transform.rotation.y;
+                rotations[4 * i + 2]    = t.transform.rotation.z;
+                rotations[4 * i + 3]    = t.transform.rotation.w;
+            }
+            w_.write(stamps);
+            w_.write(translations);
+            w_.write(rotations);
+        }
+
+        if (sequence) {
+            const std::size_t n = sequence->data.size();
+            const std::size_t joints = n > 0 ? sequence->data.front().state.name.size() : 0;
+            std::vector<uint64_t> stamps(n);
+            std::vector<double>   position, velocity, acceleration, torque;
+            std::vector<double>   gravity(3 * n), force(3 * n);
+            std::vector<int32_t>  labels(n);
+            std::vector<uint32_t> force_frames(n);
+            std::vector<std::string> frames;
+
+            auto column = [joints](const std::vector<double> &src, std::vector<double> &dst) {
+                /// missing entries are stored as zeros so every row has the same size
+                const std::size_t offset = dst.size();
+                dst.resize(offset + joints, 0.0);
+                std::copy(src.begin(), src.begin() + std::min(src.size(), joints), dst.begin() + offset);
+            };
+            auto frame_index = [&frames](const std::string &frame) {
+                auto it = std::find(frames.begin(), frames.end(), frame);
+                if (it == frames.end())
+                    it = frames.insert(frames.end(), frame);
+                return static_cast<uint32_t>(it - frames.begin());
+            };
+
+            for (std::size_t i = 0 ; i < n ; ++i) {
+                const jaco2_contact_msgs::Jaco2CollisionSample &s = sequence->data[i];
+                stamps[i] = s.state.header.stamp.toNSec();
+                column(s.state.position,     position);
+                column(s.state.velocity,     velocity);
+                column(s.state.acceleration, acceleration);
+                column(s.state.effort,       torque);
+                gravity[3 * i]     = s.state.gx;
+                gravity[3 * i + 1] = s.state.gy;
+                gravity[3 * i + 2] = s.state.gz;
+                labels[i]          = s.label;
+                force[3 * i]       = s.contact_force.vector.x;
+                force[3 * i + 1]   = s.contact_force.vector.y;
+                force[3 * i + 2]   = s.contact_force.vector.z;
+                force_frames[i]    = frame_index(s.contact_force.header.frame_id);
+            }
+
+            w_.write(static_cast<uint64_t>(n));
+            w_.write(static_cast<uint64_t>(joints));
+            for (std::size_t j = 0 ; j < joints ; ++j)
+                w_.write(sequence->data.front().state.name[j]);
+            w_.write(n > 0 ? sequence->data.front().state.header.frame_id : std::string());
+            w_.write(static_cast<uint64_t>(frames.size()));
+            for (const std::string &f : frames)
+                w_.write(f);
+            w_.write(stamps);
+            w_.write(position);
+            w_.write(velocity);
+            w_.write(acceleration);
+            w_.write(torque);
+            w_.write(gravity);
+            w_.write(labels);
+            w_.write(force_frames);
+            w_.write(force);
+            n_samples_ += n;
+        }
+        return out_.good();
+    }
+
+    /// writes the sequence index and the header, the file is incomplete before
+    bool close()
+    {
+        BinaryDataSetFormat::Header h;
+        std::memset(&h, 0, sizeof(h));
+        std::memcpy(h.magic, BinaryDataSetFormat::MAGIC, sizeof(h.magic));
+        h.version      = BinaryDataSetFormat::VERSION;
+        h.n_sequences  = offsets_.size();
+        h.index_offset = static_cast<uint64_t>(out_.tellp());
+        h.n_samples    = n_samples_;
+        w_.write(offsets_);
+        out_.seekp(0);
+        w_.write(h);
+        out_.close();
+        return !out_.fail();
+    }
+
+private:
+    std::ofstream         out_;
+    BinaryWriter          w_;
+    std::vector<uint64_t> offsets_;
+    std::size_t           n_samples_;
+};
+
+/**
+ * @brief Preprocessed data set file, written once from a bag by
+ *        muse_armcl_data_set_converter and read through a memory mapping.
+ *        Every sequence stores its tf set and the contact samples as columnar
+ *        arrays: stamps, joint positions, velocities, accelerations, torques,
+ *        gravity, labels and contact forces. Accelerometer readings are not
+ *        used by the filter and are not stored.
+ */
+class BinaryDataSet
+{
+public:
+    using Ptr = std::shared_ptr<BinaryDataSet>;
+
+    explicit BinaryDataSet(const std::string &file) :
+        mapped_(file)
+    {
+        if (!mapped_.valid())
+            throw std::runtime_error("[BinaryDataSet]: Cannot map '" + file + "'!");
+
+        BinaryReader r(mapped_.data(), mapped_.size());
+        if (!r.read(header_) ||
+                std::memcmp(header_.magic, BinaryDataSetFormat::MAGIC, sizeof(header_.magic)) != 0 ||
+                header_.version != BinaryDataSetFormat::VERSION ||
+                header_.index_offset > mapped_.size())
+            throw std::runtime_error("[BinaryDataSet]: '" + file + "' is no data set file or was not closed!");
+
+        BinaryReader index(mapped_.data() + header_.index_offset, mapped_.size() - header_.index_offset);
+        if (!index.read(offsets_, header_.n_sequences))
+            throw std::runtime_error("[BinaryDataSet]: '" + file + "' has a truncated index!");
+    }
+
+    std::size_t size() const
+    {
+        return offsets_.size();
+    }
+
+    std::size_t numSamples() const
+    {
+        return header_.n_samples;
+    }
+
+    /// decodes sequence i straight from the mapping
+    bool read(const std::size_t i, ContactEvaluationSample &sample, uint64_t &bag_time) const
+    {
+        sample = ContactEvaluationSample();
+        if (i >= offsets_.size() || offsets_[i] >= mapped_.size())
+            return false;
+
+        BinaryReader r(mapped_.data() + offsets_[i], mapped_.size() - offsets_[i]);
+        uint8_t has_transform, has_data;
+        if (!r.read(bag_time) || !r.read(has_transform) || !r.read(has_data))
+            return false;
+
+        if (has_transform) {
+            uint64_t n;
+            /// every transform stores at least the size prefixes of its two frame ids
+            if (!r.read(n) || n > r.remaining() / (2 * sizeof(uint64_t)))
+                return false;
+            std::vector<std::string> frames(n), children(n);
+            for (uint64_t t = 0 ; t < n ; ++t) {
+                if (!r.read(frames[t]) || !r.read(children[t]))
+                    return false;
+            }
+            if (!r.read(stamps_, n) || !r.read(translations_, 3 * n) || !r.read(rotations_, 4 * n))
+                return false;
+            sample.transforms.reserve(n);
+            for (uint64_t t = 0 ; t < n ; ++t) {
+                const tf::Transform transform(tf::Quaternion(rotations_[4 * t], rotations_[4 * t + 1],
+                                                             rotations_[4 * t + 2], rotations_[4 * t + 3]),
+                                              tf::Vector3(translations_[3 * t], translations_[3 * t + 1], translations_[3 * t + 2]));
+                ros::Time stamp;
+                stamp.fromNSec(stamps_[t]);
+                sample.transforms.emplace_back(transform, stamp, frames[t], children[t]);
+            }
+            sample.has_transform = true;
+        }
+
+        if (has_data) {
+            uint64_t n, joints, n_frames;
+            std::string state_frame;
+            if (!r.read(n) || !r.read(joints) ||
+                    joints > r.remaining() / sizeof(uint64_t) ||
+                    (joints > 0 && n > r.remaining() / joints))
+                return false;
+            std::vector<std::string> names(joints);
+            for (std::string &name : names) {
+                if (!r.read(name))
+                    return false;
+            }
+            if (!r.read(state_frame) || !r.read(n_frames) || n_frames > r.remaining() / sizeof(uint64_t))
+                return false;
+            std::vector<std::string> frames(n_frames);
+            for (std::string &frame : frames) {
+                if (!r.read(frame))
+                    return false;
+            }
+            if (!r.read(stamps_, n) ||
+                    !r.read(position_, n * joints) || !r.read(velocity_, n * joints) ||
+                    !r.read(acceleration_, n * joints) || !r.read(torque_, n * joints) ||
+                    !r.read(gravity_, 3 * n) || !r.read(labels_, n) ||
+                    !r.read(force_frames_, n) || !r.read(force_, 3 * n))
+                return false;
+
+            /// the samples are filled straight from the columns, only the headers go through the conversions
+            const uint64_t start_time = static_cast<uint64_t>(cslibs_time::Time::now().nanoseconds());
+            std_msgs::Header              state_header;
+            geometry_msgs::Vector3Stamped force;
+            state_header.frame_id = state_frame;
+            for (uint64_t s = 0 ; s < n ; ++s) {
+                if (force_frames_[s] >= n_frames)
+                    return false;
+                const std::size_t row = s * joints;
+                state_header.stamp.fromNSec(stamps_[s]);
+                ContactSample &c = sample.data.emplace(ContactSequence::time(stamps_[s], bag_time, start_time));
+                cslibs_kdl::HeaderConversion::ros2data(state_header, c.state.header);
+                c.state.gravity = cslibs_kdl_data::Vector3(gravity_[3 * s], gravity_[3 * s + 1], gravity_[3 * s + 2]);
+                c.state.names = names;
+                c.state.position.assign(position_.begin() + row, position_.begin() + row + joints);
+                c.state.velocity.assign(velocity_.begin() + row, velocity_.begin() + row + joints);
+                c.state.acceleration.assign(acceleration_.begin() + row, acceleration_.begin() + row + joints);
+                c.state.torque.assign(torque_.begin() + row, torque_.begin() + row + joints);
+                c.state.label   = labels_[s];
+                c.lin_acc.label = labels_[s];
+                c.label         = labels_[s];
+                force.header.stamp    = state_header.stamp;
+                force.header.frame_id = frames[force_frames_[s]];
+                force.vector.x = force_[3 * s];
+                force.vector.y = force_[3 * s + 1];
+                force.vector.z = force_[3 * s + 2];
+                cslibs_kdl::Vector3StampedConversion::ros2data(force, c.contact_force);
+            }
+            sample.has_data = true;
+        }
+        return true;
+    }
+
+    /// decodes every sequence into a data set, for consumers that need random access
+    bool load(DataSet &set) const
+    {
+        ContactEvaluationSample sample;
+        uint64_t bag_time;
+        for (std::size_t i = 0 ; i < size() ; ++i) {
+            if (!read(i, sample, bag_time))
+                return false;
+            set.n_samples += sample.data.size();
+            while (!set.push_back(bag_time, sample))
+                ++bag_time;
+        }
+        return true;
+    }
+
+private:
+    MappedFile                                  mapped_;
+    BinaryDataSetFormat::Header                 header_;
+    std::vector<uint64_t>                       offsets_;
+
+    /// column buffers reused between sequences
+    mutable std::vector<uint64_t>               stamps_;
+    mutable std::vector<double>                 translations_, rotations_;
+    mutable std::vector<double>                 position_, velocity_, acceleration_, torque_, gravity_, force_;
+    mutable std::vector<int32_t>                labels_;
+    mutable std::vector<uint32_t>               force_frames_;
+};
+}
+#endif // BINARY_DATA_SET_HPP
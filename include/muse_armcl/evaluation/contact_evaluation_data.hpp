@@ -202,37 +202,45 @@ public:
     ContactSequence() {}
 
     void setData(const uint64_t bag_time, const jaco2_contact_msgs::Jaco2CollisionSequence& data)
+    {
+        clear();
+        const uint64_t start_time = static_cast<uint64_t>(cslibs_time::Time::now().nanoseconds());
+        for(const jaco2_contact_msgs::Jaco2CollisionSample& s : data.data)
+            convert(s, emplace(time(s.state.header.stamp.toNSec(), bag_time, start_time)));
+    }
+
+    void clear()
     {
         time_to_index_.clear();
+        index_to_time_.clear();
         data_.clear();
         min_time_ = std::numeric_limits<uint64_t>::max();
         max_time_ = std::numeric_limits<uint64_t>::min();
+    }
 
-        uint64_t start_time = static_cast<uint64_t>(cslibs_time::Time::now().nanoseconds());
-        for(const jaco2_contact_msgs::Jaco2CollisionSample& s : data.data){
-            uint64_t time = s.state.header.stamp.toNSec();
-
-            if(time == 0) {
-                time = static_cast<uint64_t>(cslibs_time::Time::now().nanoseconds());
+    /// appends an empty sample to be filled in place
+    ContactSample& emplace(const uint64_t time)
+    {
+        std::size_t id = data_.size();
+        time_to_index_[time] = id;
+        index_to_time_[id] = time;
 
-                if(bag_time != 0) {
-                    time = bag_time + (time - start_time);
-                }
-            }
+        if(time < min_time_)
+            min_time_ = time;
+        if(time > max_time_)
+            max_time_ = time;
 
-            std::size_t id = data_.size();
-            time_to_index_[time] = id;
-            index_to_time_[id] = time;
-
-            if(time < min_time_)
-                min_time_ = time;
-            if(time > max_time_)
-                max_time_ = time;
+        data_.emplace_back();
+        return data_.back();
+    }
 
-            ContactSample tmp;
-            convert(s, tmp);
-            data_.emplace_back(tmp);
-        }
+    /// unstamped samples are timed by their arrival, relative to the bag time if there is one
+    static uint64_t time(const uint64_t stamp, const uint64_t bag_time, const uint64_t start_time)
+    {
+        if(stamp != 0)
+            return stamp;
+        const uint64_t now = static_cast<uint64_t>(cslibs_time::Time::now().nanoseconds());
+        return bag_time != 0 ? bag_time + (now - start_time) : now;
     }
 };
 
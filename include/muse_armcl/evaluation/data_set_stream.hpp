@@ -0,0 +1,165 @@
+#ifndef DATA_SET_STREAM_HPP
+#define DATA_SET_STREAM_HPP
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <ros/ros.h>
+#include <muse_armcl/evaluation/contact_evaluation_data.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace muse_armcl {
+/**
+ * @brief Reads a data set bag one ContactEvaluationSample at a time. A
+ *        background thread converts the following samples while the current
+ *        one is processed, at most prefetch samples are held in memory.
+ *        A tf message and a contact sequence with the same bag time form one
+ *        sample, like in DataSetLoader::loadFromBag.
+ */
+class DataSetStream
+{
+public:
+    using Ptr = std::shared_ptr<DataSetStream>;
+
+    DataSetStream(const std::string &bag_filename,
+                  const std::string &topic_tf,
+                  const std::string &topic_contact,
+                  const std::size_t  prefetch = 1) :
+        bag_(bag_filename, rosbag::bagmode::Read),
+        topic_tf_(topic_tf),
+        topic_contact_(topic_contact),
+        prefetch_(std::max<std::size_t>(1, prefetch)),
+        expected_(0),
+        n_samples_(0),
+        done_(false),
+        stop_(false)
+    {
+        view_.reset(new rosbag::View(bag_, rosbag::TopicQuery(std::vector<std::string>{topic_tf_, topic_contact_})));
+        expected_ = view_->size() / 2;
+        worker_ = std::thread([this]() { read(); });
+    }
+
+    ~DataSetStream()
+    {
+        {
+            std::unique_lock<std::mutex> l(mutex_);
+            stop_ = true;
+        }
+        notify_.notify_all();
+        if (worker_.joinable())
+            worker_.join();
+        bag_.close();
+    }
+
+    /// blocks until the next sample is converted, false at the end of the bag
+    bool next(ContactEvaluationSample &sample)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        notify_.wait(l, [this]() { return !queue_.empty() || done_; });
+        if (queue_.empty())
+            return false;
+        sample = std::move(queue_.front());
+        queue_.pop_front();
+        l.unlock();
+        notify_.notify_all();
+        return true;
+    }
+
+    /// number of samples in the bag, assuming one tf message per contact sequence
+    std::size_t expectedSize() const
+    {
+        return expected_;
+    }
+
+    /// contact samples of all sequences read so far
+    std::size_t samplesRead() const
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        return n_samples_;
+    }
+
+private:
+    rosbag::Bag                             bag_;
+    std::unique_ptr<rosbag::View>           view_;
+    std::string                             topic_tf_;
+    std::string                             topic_contact_;
+    std::size_t                             prefetch_;
+    std::size_t                             expected_;
+    std::size_t                             n_samples_;
+
+    mutable std::mutex                      mutex_;
+    std::condition_variable                 notify_;
+    std::deque<ContactEvaluationSample>     queue_;
+    bool                                    done_;
+    bool                                    stop_;
+    std::thread                             worker_;
+
+    void read()
+    {
+        ContactEvaluationSample sample;
+        uint64_t sample_time = 0;
+        for (const rosbag::MessageInstance &m : *view_) {
+            const uint64_t nsecs = m.getTime().toNSec();
+            const bool is_tf = m.getTopic() == topic_tf_;
+            if (!is_tf && m.getTopic() != topic_contact_)
+                continue;
+
+            /// a new bag time or a second message of the same kind starts the next sample
+            if ((sample.has_transform || sample.has_data) &&
+                    (nsecs != sample_time || (is_tf ? sample.has_transform : sample.has_data))) {
+                if (!push(sample))
+                    return;
+                sample = ContactEvaluationSample();
+            }
+            sample_time = nsecs;
+
+            if (is_tf) {
+                tf::tfMessage::ConstPtr tf = m.instantiate<tf::tfMessage>();
+                if (!tf) {
+                    std::cerr << "Cannot instantiate tf::tfMessage!" << std::endl;
+                    continue;
+                }
+                sample.transforms.reserve(tf->transforms.size());
+                for (const geometry_msgs::TransformStamped &t : tf->transforms) {
+                    sample.transforms.emplace_back();
+                    tf::transformStampedMsgToTF(t, sample.transforms.back());
+                }
+                sample.has_transform = true;
+            } else {
+                jaco2_contact_msgs::Jaco2CollisionSequence::ConstPtr sequence = m.instantiate<jaco2_contact_msgs::Jaco2CollisionSequence>();
+                if (!sequence) {
+                    std::cerr << "Cannot instantiate jaco2_contact_msgs::Jaco2CollisionSequence!" << std::endl;
+                    continue;
+                }
+                sample.data.setData(nsecs, *sequence);
+                sample.has_data = true;
+            }
+        }
+        if (sample.has_transform || sample.has_data)
+            push(sample);
+
+        std::unique_lock<std::mutex> l(mutex_);
+        done_ = true;
+        l.unlock();
+        notify_.notify_all();
+    }
+
+    /// waits for a free prefetch slot, false if the stream is destroyed
+    bool push(ContactEvaluationSample &sample)
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        notify_.wait(l, [this]() { return queue_.size() < prefetch_ || stop_; });
+        if (stop_)
+            return false;
+        n_samples_ += sample.data.size();
+        queue_.emplace_back(std::move(sample));
+        l.unlock();
+        notify_.notify_all();
+        return true;
+    }
+};
+}
+#endif // DATA_SET_STREAM_HPP
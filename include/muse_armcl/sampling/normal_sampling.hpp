@@ -28,14 +28,14 @@ public:
     {
         auto param_name = [this](const std::string &name){return name_ + "/" + name;};
         sample_size_ = static_cast<std::size_t>(nh.param(param_name("sample_size"), 500));
-        sampling_timeout_ = ros::Duration(nh.param(param_name("sampling_timeout"), 10.0));
+        sampling_timeout_ = ros::WallDuration(nh.param(param_name("sampling_timeout"), 10.0));
 
         doSetup(map_providers, nh);
     }
 
 protected:
     std::size_t        sample_size_;
-    ros::Duration      sampling_timeout_;
+    ros::WallDuration  sampling_timeout_;  /// computation budget, independent of the data time
 
     virtual void doSetup(const map_provider_map_t &map_providers,
                          ros::NodeHandle &nh) = 0;
@@ -0,0 +1,219 @@
+#ifndef MUSE_ARMCL_COMPILED_MESH_MAP_HPP
+#define MUSE_ARMCL_COMPILED_MESH_MAP_HPP
+
+#include <muse_armcl/state_space/state_space_description.hpp>
+#include <muse_armcl/state_space/kinematic_snapshot.hpp>
+#include <muse_armcl/common/thread_pool.hpp>
+
+#include <cslibs_mesh_map/mesh_map_tree.h>
+#include <cslibs_math_3d/linear/vector.hpp>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace muse_armcl {
+/**
+ * @brief Read-only flat copy of one mesh link. Vertex attributes are stored as
+ *        structure of arrays, the vertex adjacency in CSR layout. Vertex indices
+ *        are the OpenMesh vertex indices, so states can be used directly.
+ */
+class CompiledMeshMap
+{
+public:
+    using Ptr      = std::shared_ptr<CompiledMeshMap>;
+    using ConstPtr = std::shared_ptr<CompiledMeshMap const>;
+    using index_t  = uint32_t;
+    using state_t  = StateSpaceDescription::state_t;
+
+    std::size_t          map_id = 0;
+    std::string          frame_id;
+
+    std::vector<double>  x, y, z;           /// vertex positions
+    std::vector<double>  nx, ny, nz;        /// vertex normals
+    std::vector<uint8_t> boundary;          /// vertex is on a mesh boundary
+
+    std::vector<index_t> adjacency_offsets; /// CSR row offsets, size = vertices + 1
+    std::vector<index_t> adjacency;         /// neighbouring vertices
+    std::vector<index_t> adjacency_edges;   /// edge index of every adjacency entry
+
+    std::vector<index_t> edge_from;         /// undirected edges, from < to
+    std::vector<index_t> edge_to;
+    std::vector<double>  edge_length;
+    double               edge_length_sum = 0.0;
+
+    /// decimated level of detail, every cluster is represented by one of its full resolution vertices
+    struct Level
+    {
+        double               cell_size = 0.0;
+        std::vector<index_t> vertices;          /// representative full resolution vertex of every cluster
+        std::vector<index_t> cluster;           /// cluster of every full resolution vertex
+        std::vector<index_t> parent;            /// cluster of every node of the next finer level
+        std::vector<index_t> children_offsets;  /// CSR row offsets into children, size = clusters + 1
+        std::vector<index_t> children;          /// nodes of the next finer level
+        std::vector<index_t> adjacency_offsets; /// CSR row offsets into adjacency, size = clusters + 1
+        std::vector<index_t> adjacency;         /// neighbouring clusters
+        std::vector<index_t> boundary_offsets;  /// CSR row offsets into boundary, size = clusters + 1
+        std::vector<index_t> boundary;          /// full resolution boundary vertices of every cluster
+
+        inline std::size_t size() const
+        {
+            return vertices.size();
+        }
+    };
+
+    /// levels[0] is the finest decimated level, the full resolution mesh is its next finer level
+    std::vector<Level>      levels;
+
+    inline std::size_t numVertices() const
+    {
+        return x.size();
+    }
+
+    inline std::size_t numEdges() const
+    {
+        return edge_from.size();
+    }
+
+    inline cslibs_math_3d::Vector3d point(const index_t v) const
+    {
+        return cslibs_math_3d::Vector3d(x[v], y[v], z[v]);
+    }
+
+    inline cslibs_math_3d::Vector3d normal(const index_t v) const
+    {
+        return cslibs_math_3d::Vector3d(nx[v], ny[v], nz[v]);
+    }
+
+    inline const index_t* neighboursBegin(const index_t v) const
+    {
+        return adjacency.data() + adjacency_offsets[v];
+    }
+
+    inline const index_t* neighboursEnd(const index_t v) const
+    {
+        return adjacency.data() + adjacency_offsets[v + 1];
+    }
+
+    inline std::size_t degree(const index_t v) const
+    {
+        return adjacency_offsets[v + 1] - adjacency_offsets[v];
+    }
+
+    /// same interpolation along the active edge as EdgeParticle::getPosition
+    inline cslibs_math_3d::Vector3d position(const state_t &state) const
+    {
+        const index_t a = static_cast<index_t>(state.active_vertex.idx());
+        const index_t g = static_cast<index_t>(state.goal_vertex.idx());
+        const double  s = state.s;
+        return cslibs_math_3d::Vector3d(x[a] + s * (x[g] - x[a]),
+                                        y[a] + s * (y[g] - y[a]),
+                                        z[a] + s * (z[g] - z[a]));
+    }
+
+    /// interpolated vertex normal along the active edge, normalized
+    inline cslibs_math_3d::Vector3d normal(const state_t &state) const
+    {
+        const index_t a = static_cast<index_t>(state.active_vertex.idx());
+        const index_t g = static_cast<index_t>(state.goal_vertex.idx());
+        const double  s = state.s;
+        const cslibs_math_3d::Vector3d n(nx[a] + s * (nx[g] - nx[a]),
+                                         ny[a] + s * (ny[g] - ny[a]),
+                                         nz[a] + s * (nz[g] - nz[a]));
+        const double l = n.length();
+        return l > 0.0 ? n * (1.0 / l) : normal(a);
+    }
+};
+
+/**
+ * @brief Compiled views of all links of a mesh map tree, indexed by map id.
+ *        Cross link jump targets depend on the link transforms, they are only
+ *        part of the copies made by withJumpTargets for one kinematic
+ *        snapshot, which share the compiled links with this tree.
+ */
+class CompiledMeshMapTree
+{
+public:
+    using Ptr      = std::shared_ptr<CompiledMeshMapTree>;
+    using ConstPtr = std::shared_ptr<CompiledMeshMapTree const>;
+    using index_t  = CompiledMeshMap::index_t;
+
+    /// vertex on a neighbouring link that is reached when leaving through a boundary vertex
+    struct JumpTarget
+    {
+        index_t map_id;
+        index_t vertex;
+    };
+
+    /// compile all links without jump targets, one link per job if a pool is given
+    static Ptr build(const cslibs_mesh_map::MeshMapTree &tree,
+                     ThreadPool *pool = nullptr);
+
+    /// copy sharing the compiled links, with the jump targets for the link transforms of the snapshot
+    ConstPtr withJumpTargets(const KinematicSnapshot &kinematics,
+                             ThreadPool *pool = nullptr) const;
+
+    /// decimate every link into levels of detail by vertex clustering on grids with
+    /// the given increasing cell sizes, only before the tree is shared
+    void buildLevels(const std::vector<double> &cell_sizes,
+                     ThreadPool *pool = nullptr);
+
+    /// number of decimated levels, the same for all links
+    inline std::size_t numLevels() const
+    {
+        for (const CompiledMeshMap::Ptr &m : maps_) {
+            if (m)
+                return m->levels.size();
+        }
+        return 0;
+    }
+
+    inline const CompiledMeshMap* get(const std::size_t map_id) const
+    {
+        return map_id < maps_.size() && maps_[map_id] ? maps_[map_id].get() : nullptr;
+    }
+
+    inline std::size_t size() const
+    {
+        return maps_.size();
+    }
+
+    /// add or replace the compiled view of a link
+    inline void insert(const CompiledMeshMap::Ptr &map)
+    {
+        if (map->map_id >= maps_.size())
+            maps_.resize(map->map_id + 1);
+        maps_[map->map_id] = map;
+    }
+
+    /// version of the snapshot the jump targets belong to, 0 without jump targets
+    inline uint64_t kinematicsVersion() const
+    {
+        return kinematics_version_;
+    }
+
+    /// jump targets of a vertex, empty without jump targets
+    inline const JumpTarget* jumpsBegin(const std::size_t map_id, const index_t v) const
+    {
+        return hasJumps(map_id) ? jumps_[map_id].data() + jump_offsets_[map_id][v] : nullptr;
+    }
+
+    inline const JumpTarget* jumpsEnd(const std::size_t map_id, const index_t v) const
+    {
+        return hasJumps(map_id) ? jumps_[map_id].data() + jump_offsets_[map_id][v + 1] : nullptr;
+    }
+
+private:
+    std::vector<CompiledMeshMap::Ptr>    maps_;
+    std::vector<std::vector<index_t>>    jump_offsets_;  /// CSR row offsets per link, size = vertices + 1
+    std::vector<std::vector<JumpTarget>> jumps_;
+    uint64_t                             kinematics_version_ = 0;
+
+    inline bool hasJumps(const std::size_t map_id) const
+    {
+        return map_id < jump_offsets_.size() && !jump_offsets_[map_id].empty();
+    }
+};
+}
+
+#endif // MUSE_ARMCL_COMPILED_MESH_MAP_HPP
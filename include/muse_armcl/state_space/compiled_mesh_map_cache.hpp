@@ -0,0 +1,49 @@
+#ifndef MUSE_ARMCL_COMPILED_MESH_MAP_CACHE_HPP
+#define MUSE_ARMCL_COMPILED_MESH_MAP_CACHE_HPP
+
+#include <muse_armcl/state_space/compiled_mesh_map.hpp>
+
+namespace muse_armcl {
+/**
+ * @brief Binary cache of the compiled mesh map. The cache is keyed by a hash
+ *        over the mesh file metadata and the loader parameters and is read
+ *        through a read-only memory mapping, the arrays are copied into the
+ *        compiled links. A hit only skips the compilation and the decimation
+ *        into levels of detail, the OBJ meshes are still parsed into the mesh
+ *        map tree, which backs the frames and the visualization, so a warm
+ *        start still pays for reading every mesh. Jump targets depend on the
+ *        link transforms and are not cached, neither are the labelled contact
+ *        points, which belong to the densities.
+ */
+class CompiledMeshMapCache
+{
+public:
+    /// FNV-1a hash over path, size and modification time of the mesh files, the tree layout
+    /// and the cell sizes of the levels of detail
+    static uint64_t key(const std::string              &path,
+                        const std::vector<std::string> &files,
+                        const std::vector<std::string> &parent_ids,
+                        const std::vector<std::string> &frame_ids,
+                        const std::vector<double>      &cell_sizes);
+
+    /// nullptr if the cache is missing, stale or does not match the tree
+    static CompiledMeshMapTree::Ptr load(const std::string                  &file,
+                                         const uint64_t                      key,
+                                         const cslibs_mesh_map::MeshMapTree &tree);
+
+    /// written to a temporary file first, so readers never see a partial cache
+    static bool save(const std::string         &file,
+                     const uint64_t             key,
+                     const CompiledMeshMapTree &compiled);
+
+    /// load the cache or compile the tree with the given levels of detail and regenerate it,
+    /// an empty file name disables caching
+    static CompiledMeshMapTree::Ptr loadOrBuild(const std::string                  &file,
+                                                const uint64_t                      key,
+                                                const cslibs_mesh_map::MeshMapTree &tree,
+                                                const std::vector<double>          &cell_sizes,
+                                                ThreadPool                         *pool = nullptr);
+};
+}
+
+#endif // MUSE_ARMCL_COMPILED_MESH_MAP_CACHE_HPP
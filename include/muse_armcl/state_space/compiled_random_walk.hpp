@@ -0,0 +1,109 @@
+#ifndef MUSE_ARMCL_COMPILED_RANDOM_WALK_HPP
+#define MUSE_ARMCL_COMPILED_RANDOM_WALK_HPP
+
+#include <muse_armcl/state_space/compiled_mesh_map.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+#include <algorithm>
+
+namespace muse_armcl {
+/**
+ * @brief Random walk of a given distance along the edges of the compiled
+ *        links, replaces cslibs_mesh_map::RandomWalk. A particle keeps its
+ *        direction along the current edge, picks a random neighbour at every
+ *        vertex without turning back and leaves its link through boundary
+ *        vertices with the jump probability, if the tree has jump targets.
+ *        Every draw comes from the generator that is passed in, a seeded
+ *        generator makes walks reproducible.
+ */
+class CompiledRandomWalk
+{
+public:
+    using index_t  = CompiledMeshMap::index_t;
+    using state_t  = StateSpaceDescription::state_t;
+    using rng_t    = cslibs_math::random::Uniform<double,1>; /// has to draw from [0, 1)
+    using vertex_t = cslibs_mesh_map::MeshMap::VertexHandle;
+
+    double      jump_probability = 0.3;
+    std::size_t max_steps        = 256;
+
+    inline void update(state_t                   &state,
+                       const CompiledMeshMapTree &compiled,
+                       double                     distance,
+                       rng_t                     &rng) const
+    {
+        const CompiledMeshMap *c = compiled.get(state.map_id);
+        if (!c)
+            return;
+
+        /// finish the current edge first
+        std::size_t map_id = state.map_id;
+        index_t     prev   = static_cast<index_t>(state.active_vertex.idx());
+        index_t     v      = static_cast<index_t>(state.goal_vertex.idx());
+        if (prev != v) {
+            const double length = (c->point(v) - c->point(prev)).length();
+            const double rest   = (1.0 - state.s) * length;
+            if (distance < rest) {
+                set(state, map_id, prev, v, length > 0.0 ? state.s + distance / length : state.s);
+                return;
+            }
+            distance -= rest;
+        }
+
+        for (std::size_t step = 0 ; step < max_steps ; ++step) {
+            /// switch links through a boundary vertex, there is no way back to the previous vertex
+            const std::size_t n_jumps = compiled.jumpsEnd(map_id, v) - compiled.jumpsBegin(map_id, v);
+            if (n_jumps > 0 && rng.get() < jump_probability) {
+                const CompiledMeshMapTree::JumpTarget &j = compiled.jumpsBegin(map_id, v)[pick(n_jumps, rng)];
+                if (compiled.get(j.map_id)) {
+                    map_id = j.map_id;
+                    v      = j.vertex;
+                    prev   = v;
+                    c      = compiled.get(map_id);
+                }
+            }
+
+            const std::size_t degree = c->degree(v);
+            if (degree == 0)
+                break;
+            index_t next = c->neighboursBegin(v)[pick(degree, rng)];
+            if (next == prev && degree > 1) {
+                /// any other neighbour, still uniformly
+                const std::size_t i = pick(degree - 1, rng);
+                const index_t *n = c->neighboursBegin(v);
+                next = n[i] == prev ? n[degree - 1] : n[i];
+            }
+
+            const double length = (c->point(next) - c->point(v)).length();
+            if (distance < length || step + 1 == max_steps) {
+                set(state, map_id, v, next, length > 0.0 ? std::min(1.0, distance / length) : 0.0);
+                return;
+            }
+            distance -= length;
+            prev = v;
+            v    = next;
+        }
+
+        /// isolated vertex, stay on it
+        set(state, map_id, v, v, 0.0);
+    }
+
+private:
+    /// uniform index in [0, n)
+    inline static std::size_t pick(const std::size_t n, rng_t &rng)
+    {
+        return std::min(n - 1, static_cast<std::size_t>(rng.get() * static_cast<double>(n)));
+    }
+
+    inline static void set(state_t &state, const std::size_t map_id, const index_t active, const index_t goal, const double s)
+    {
+        state.map_id        = map_id;
+        state.active_vertex = vertex_t(static_cast<int>(active));
+        state.goal_vertex   = vertex_t(static_cast<int>(goal));
+        state.s             = s;
+    }
+};
+}
+
+#endif // MUSE_ARMCL_COMPILED_RANDOM_WALK_HPP
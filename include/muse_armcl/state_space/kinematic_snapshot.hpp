@@ -0,0 +1,165 @@
+#ifndef MUSE_ARMCL_KINEMATIC_SNAPSHOT_HPP
+#define MUSE_ARMCL_KINEMATIC_SNAPSHOT_HPP
+
+#include <cslibs_mesh_map/mesh_map_tree.h>
+#include <cslibs_math_3d/linear/transform.hpp>
+#include <cslibs_time/time.hpp>
+#include <kdl/frames.hpp>
+
+#include <memory>
+#include <vector>
+#include <limits>
+
+namespace muse_armcl {
+/**
+ * @brief Link nodes and base transforms of the mesh map tree for one joint
+ *        state, indexed densely by map id. Built by the update model from the
+ *        forward kinematics, so consumers neither search the tree nor compose
+ *        transforms along the parent links, and the link transforms stored in
+ *        the tree are never read by the filter.
+ *        Snapshots are immutable once published and carry a version, so one
+ *        filter stage can keep reading a snapshot while the next joint state
+ *        is already being applied.
+ */
+class EIGEN_ALIGN16 KinematicSnapshot
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t        = Eigen::aligned_allocator<KinematicSnapshot>;
+    using Ptr                = std::shared_ptr<KinematicSnapshot>;
+    using ConstPtr           = std::shared_ptr<KinematicSnapshot const>;
+    using node_t             = cslibs_mesh_map::MeshMapTreeNode;
+    using transform_t        = cslibs_math_3d::Transform3d;
+    using transform_vector_t = std::vector<transform_t, Eigen::aligned_allocator<transform_t>>;
+    using time_t             = cslibs_time::Time;
+    using jacobian_t         = Eigen::MatrixXd;
+    using frame_vector_t     = std::vector<KDL::Frame>;
+    using jacobian_vector_t  = std::vector<jacobian_t>;
+
+    static constexpr std::size_t NO_PARENT = std::numeric_limits<std::size_t>::max();
+
+    /// snapshot of one joint state, the tree only provides the link structure and is not written,
+    /// parent_T_link and jacobians are indexed by map id
+    inline static Ptr build(const cslibs_mesh_map::MeshMapTree &tree,
+                            frame_vector_t                    &&parent_T_link,
+                            jacobian_vector_t                 &&jacobians,
+                            const time_t                       &stamp,
+                            const uint64_t                      version)
+    {
+        Ptr s(new KinematicSnapshot);
+        s->stamp_         = stamp;
+        s->version_       = version;
+        s->parent_T_link_ = std::move(parent_T_link);
+        s->jacobians_     = std::move(jacobians);
+
+        std::vector<std::size_t> &parents = s->parents_;
+        for (const cslibs_mesh_map::MeshMapTreeNode::Ptr &node : tree) {
+            const std::size_t map_id = node->mapId();
+            s->resize(map_id);
+            s->nodes_[map_id] = node.get();
+
+            std::string parent;
+            const cslibs_mesh_map::MeshMapTreeNode *p = node->parentFrameId(parent) ? tree.getNode(parent) : nullptr;
+            parents[map_id] = p ? p->mapId() : NO_PARENT;
+        }
+        s->parent_T_link_.resize(s->nodes_.size(), KDL::Frame::Identity());
+        s->jacobians_.resize(s->nodes_.size());
+
+        /// compose the base transforms along the parent links, every link once
+        std::vector<uint8_t> done(s->nodes_.size(), 0);
+        std::vector<std::size_t> chain;
+        for (std::size_t map_id = 0 ; map_id < s->nodes_.size() ; ++map_id) {
+            if (!s->nodes_[map_id])
+                continue;
+            for (std::size_t m = map_id ; m != NO_PARENT && !done[m] ; m = parents[m])
+                chain.emplace_back(m);
+            for (auto it = chain.rbegin() ; it != chain.rend() ; ++it) {
+                const std::size_t m = *it;
+                const transform_t p_T_l = convert(s->parent_T_link_[m]);
+                s->base_T_link_[m] = parents[m] != NO_PARENT ? s->base_T_link_[parents[m]] * p_T_l : p_T_l;
+                done[m] = 1;
+            }
+            chain.clear();
+        }
+        return s;
+    }
+
+    /// nullptr for unknown map ids
+    inline const node_t* node(const std::size_t map_id) const
+    {
+        return map_id < nodes_.size() ? nodes_[map_id] : nullptr;
+    }
+
+    /// map id of the parent link, NO_PARENT for the root and unknown map ids
+    inline std::size_t parent(const std::size_t map_id) const
+    {
+        return map_id < parents_.size() ? parents_[map_id] : NO_PARENT;
+    }
+
+    /// only valid for map ids with a node
+    inline const transform_t& baseTLink(const std::size_t map_id) const
+    {
+        return base_T_link_[map_id];
+    }
+
+    /// link transform relative to the parent link
+    inline const KDL::Frame& linkFrame(const std::size_t map_id) const
+    {
+        return parent_T_link_[map_id];
+    }
+
+    /// transposed geometric jacobian of the link, empty for links without one
+    inline const jacobian_t& jacobian(const std::size_t map_id) const
+    {
+        return jacobians_[map_id];
+    }
+
+    inline bool hasJacobians() const
+    {
+        return jacobians_.size() == nodes_.size() && !nodes_.empty();
+    }
+
+    inline std::size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    inline const time_t& stamp() const
+    {
+        return stamp_;
+    }
+
+    inline uint64_t version() const
+    {
+        return version_;
+    }
+
+private:
+    inline void resize(const std::size_t map_id)
+    {
+        if (map_id >= nodes_.size()) {
+            nodes_.resize(map_id + 1, nullptr);
+            parents_.resize(map_id + 1, std::size_t(NO_PARENT));
+            base_T_link_.resize(map_id + 1, transform_t());
+        }
+    }
+
+    inline static transform_t convert(const KDL::Frame &f)
+    {
+        double x, y, z, w;
+        f.M.GetQuaternion(x, y, z, w);
+        return transform_t(cslibs_math_3d::Vector3d(f.p.x(), f.p.y(), f.p.z()),
+                           cslibs_math_3d::Quaterniond(x, y, z, w));
+    }
+
+    std::vector<const node_t*> nodes_;
+    std::vector<std::size_t>   parents_;
+    transform_vector_t         base_T_link_;
+    frame_vector_t             parent_T_link_;
+    jacobian_vector_t          jacobians_;
+    time_t                     stamp_;
+    uint64_t                   version_ = 0;
+};
+}
+
+#endif // MUSE_ARMCL_KINEMATIC_SNAPSHOT_HPP
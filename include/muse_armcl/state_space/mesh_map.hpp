@@ -3,9 +3,13 @@
 
 #include <muse_smc/state_space/state_space.hpp>
 #include <muse_armcl/state_space/state_space_description.hpp>
+#include <muse_armcl/state_space/compiled_mesh_map.hpp>
+#include <muse_armcl/state_space/kinematic_snapshot.hpp>
 
 #include <cslibs_mesh_map/mesh_map_tree.h>
 
+#include <atomic>
+
 namespace muse_armcl {
 class EIGEN_ALIGN16 MeshMap : public muse_smc::StateSpace<StateSpaceDescription>
 {
@@ -56,8 +60,62 @@ public:
         return data_;
     }
 
+    /// flat read-only copy of the links, nullptr if the map was not compiled
+    const CompiledMeshMapTree* compiled() const
+    {
+        return compiled_.get();
+    }
+
+    void setCompiled(const CompiledMeshMapTree::ConstPtr &compiled)
+    {
+        compiled_ = compiled;
+        std::atomic_store(&posed_, CompiledMeshMapTree::ConstPtr());
+    }
+
+    /// latest published snapshot, readers keep it for a whole pass and never see a partial update
+    KinematicSnapshot::ConstPtr snapshot() const
+    {
+        return std::atomic_load(&snapshot_);
+    }
+
+    /// replace the latest snapshot, the kinematic state is not part of the map's constness
+    void publishSnapshot(const KinematicSnapshot::ConstPtr &snapshot) const
+    {
+        std::atomic_store(&snapshot_, snapshot);
+    }
+
+    uint64_t nextSnapshotVersion() const
+    {
+        return ++snapshot_version_;
+    }
+
+    /// compiled links with the jump targets of the snapshot, computed once per snapshot version,
+    /// without a snapshot, i.e. before the first update, the links have no jump targets
+    CompiledMeshMapTree::ConstPtr compiled(const KinematicSnapshot::ConstPtr &kinematics) const
+    {
+        if (!compiled_ || !kinematics)
+            return compiled_;
+        CompiledMeshMapTree::ConstPtr posed = std::atomic_load(&posed_);
+        if (!posed || posed->kinematicsVersion() != kinematics->version()) {
+            posed = compiled_->withJumpTargets(*kinematics);
+            std::atomic_store(&posed_, posed);
+        }
+        return posed;
+    }
+
+    /// particle position in link coordinates, read from the compiled map if available
+    cslibs_math_3d::Vector3d position(const state_t &state) const
+    {
+        const CompiledMeshMap *c = compiled_ ? compiled_->get(state.map_id) : nullptr;
+        return c ? c->position(state) : state.getPosition(data_->getNode(state.map_id)->map);
+    }
+
 private:
-    map_t* data_;
+    map_t*                          data_;
+    CompiledMeshMapTree::ConstPtr   compiled_;
+    mutable CompiledMeshMapTree::ConstPtr posed_;
+    mutable KinematicSnapshot::ConstPtr snapshot_;
+    mutable std::atomic<uint64_t>   snapshot_version_{0};
 };
 }
 
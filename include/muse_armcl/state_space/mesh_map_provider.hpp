@@ -45,6 +45,11 @@ public:
 
     virtual bool initializeTF(const std::vector<tf::StampedTransform>& transforms) = 0;
 
+    /// abort a waitForStateSpace that blocks, e.g. on nodelet unload
+    virtual void stop()
+    {
+    }
+
 protected:
     ros::Duration      tf_timeout_;
     tf_provider_t::Ptr tf_;
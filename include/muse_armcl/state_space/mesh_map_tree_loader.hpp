@@ -0,0 +1,52 @@
+#ifndef MUSE_ARMCL_MESH_MAP_TREE_LOADER_HPP
+#define MUSE_ARMCL_MESH_MAP_TREE_LOADER_HPP
+
+#include <cslibs_mesh_map/mesh_map_tree.h>
+#include <ros/console.h>
+#include <ros/time.h>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace muse_armcl {
+/**
+ * @brief Replacement for MeshMapTree::loadFromFile with per link timing.
+ *        OpenMesh reads through a process wide IO manager which is not thread
+ *        safe, so the links are parsed one after another, also across loaders.
+ *        Only the compilation of the parsed links runs on the pool.
+ */
+inline void loadMeshMapTree(cslibs_mesh_map::MeshMapTree   &tree,
+                            const std::string              &path,
+                            const std::vector<std::string> &parent_ids,
+                            const std::vector<std::string> &frame_ids,
+                            const std::vector<std::string> &files,
+                            const std::string              &name)
+{
+    if (files.size() != frame_ids.size() || files.size() != parent_ids.size())
+        throw std::runtime_error("[" + name + "]: meshes, parent_ids and frame_ids have to be of the same size!");
+
+    static std::mutex read_mutex;
+
+    const std::string prefix = path.empty() || path.back() == '/' ? path : path + "/";
+    const ros::WallTime start = ros::WallTime::now();
+    for (std::size_t i = 0 ; i < files.size() ; ++i) {
+        const ros::WallTime link_start = ros::WallTime::now();
+        cslibs_mesh_map::MeshMap map;
+        {
+            std::unique_lock<std::mutex> l(read_mutex);
+            map.loadMeshWithNormals(prefix + files[i]);
+        }
+        map.frame_id_  = frame_ids[i];
+        map.parent_id_ = parent_ids[i];
+        ROS_INFO_STREAM("[" << name << "]: Parsed link " << frame_ids[i] << " with "
+                        << map.mesh_.n_vertices() << " vertices in "
+                        << (ros::WallTime::now() - link_start).toSec() * 1e3 << "ms.");
+        if (!tree.add(parent_ids[i], map))
+            throw std::runtime_error("[" + name + "]: Cannot add link " + frame_ids[i] + " to the mesh map tree!");
+    }
+    ROS_INFO_STREAM("[" << name << "]: Parsed " << files.size() << " meshes in "
+                    << (ros::WallTime::now() - start).toSec() * 1e3 << "ms.");
+}
+}
+
+#endif // MUSE_ARMCL_MESH_MAP_TREE_LOADER_HPP
@@ -7,8 +7,24 @@
 #include <cslibs_kdl/yaml_to_kdl_tranform.h>
 #include <ros/ros.h>
 #include <visualization_msgs/Marker.h>
+#include <visualization_msgs/MarkerArray.h>
+#include <cslibs_kdl_msgs/ContactMessageArray.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <muse_armcl/ContactProbabilities.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace muse_armcl {
+/**
+ * @brief Publishes particles and contacts on a dedicated thread. The filter
+ *        thread only copies the samples and the detected contacts into a
+ *        pending frame, which the publishing thread swaps with its working
+ *        frame. Topics without subscribers are skipped and every topic is
+ *        rate limited, a pending frame that was not picked up in time is
+ *        replaced by the newer one.
+ */
 class EIGEN_ALIGN16 StatePublisher : public muse_smc::SMCState<StateSpaceDescription>
 {
 public:
@@ -19,6 +35,10 @@ public:
     using map_provider_map_t = std::map<std::string, MeshMapProvider::Ptr>;
     using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
     using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
+    using sample_t = StateSpaceDescription::sample_t;
+    using sample_vector_t = std::vector<sample_t, sample_t::allocator_t>;
+
+    virtual ~StatePublisher();
 
     void setup(ros::NodeHandle &nh, map_provider_map_t &map_providers);
 
@@ -27,6 +47,32 @@ public:
     virtual void publishConstant(const typename sample_set_t::ConstPtr &sample_set) override;
 
 protected:
+    /// everything the publishing thread needs of one sample set
+    struct Frame
+    {
+        uint64_t                                          nsecs = 0;
+        ros::Time                                         stamp;
+        muse_smc::StateSpace<StateSpaceDescription>::ConstPtr state_space;
+        KinematicSnapshot::ConstPtr                       kinematics;
+        bool                                              particles = false;
+        bool                                              contacts  = false;
+        bool                                              probabilities = false;
+        bool                                              discrete  = false;
+        sample_vector_t                                   samples;
+        sample_vector_t                                   detected;
+        std::vector<std::pair<int, double>>               labels;
+    };
+
+    /// particle cloud content, every particle, the heaviest particles or one point per vertex
+    enum class CloudMode { ALL, TOP_N, PER_VERTEX };
+
+    /// particle weights summed per vertex of one link, occupied lists the touched vertices
+    struct VertexWeights
+    {
+        std::vector<double> weight;
+        std::vector<int>    occupied;
+    };
+
     MeshMapProvider::Ptr map_provider_;
 
     bool           publish_cloud_;
@@ -34,16 +80,60 @@ protected:
     ros::Publisher pub_particles_;
     ros::Publisher pub_contacts_;
     ros::Publisher pub_contacts_vis_;
+    ros::Publisher pub_probabilities_;
+
+    CloudMode                     cloud_mode_;
+    std::size_t                   cloud_max_points_;
+    sensor_msgs::PointCloud2::Ptr cloud_;           /// refilled in place once no subscriber holds it anymore
+    std::vector<std::size_t>      cloud_order_;
+    std::vector<VertexWeights>    vertex_weights_;  /// indexed by map id
+    double                        vertex_max_weight_   = 0.0;
+    double                        vertex_total_weight_ = 0.0;
+
+    /// contact probability per vertex of all links in map id order, in delta mode only
+    /// the changes to the field the subscribers already have are sent between keyframes
+    bool                                probabilities_delta_;
+    double                              probabilities_threshold_;
+    std::size_t                         probabilities_keyframe_;
+    std::size_t                         probabilities_since_keyframe_ = 0;
+    std::vector<float>                  probabilities_;
+    std::vector<float>                  probabilities_sent_;
+    uint32_t                            probabilities_subscribers_ = 0;  /// a new subscriber needs a keyframe
+    std::vector<std_msgs::MultiArrayDimension> probabilities_links_;
+    ContactProbabilities::Ptr           probabilities_msg_;
+
+    /// rate limits per topic, zero publishes every sample set
+    ros::WallDuration particles_period_;
+    ros::WallDuration contacts_period_;
+    ros::WallDuration probabilities_period_;
+    ros::WallTime     next_particles_;
+    ros::WallTime     next_contacts_;
+    ros::WallTime     next_probabilities_;
+
+    /// pending is written by the filter thread, working is only touched by the publishing thread
+    std::mutex              frame_mutex_;
+    std::condition_variable frame_notify_;
+    Frame                   pending_;
+    Frame                   working_;
+    bool                    has_pending_ = false;
+    bool                    stop_        = false;
+    std::thread             worker_;
+
+    /// contacts of the last estimated sample set stamp, published as shared messages so
+    /// subscribers in the same process receive them without a copy, never modified once published
+    uint64_t                                     contacts_stamp_ = 0;
+    cslibs_kdl_msgs::ContactMessageArray::Ptr    contacts_msg_;
+    visualization_msgs::MarkerArray::Ptr         contacts_markers_;
 
     void publish(const typename sample_set_t::ConstPtr &sample_set, const bool &publish_contacts);
-    void publishContacts(const typename sample_set_t::ConstPtr & sample_set,
-                         const mesh_map_tree_t* map,
-                         const ros::Time& stamp,
+    void loop();
+    void publishFrame(const Frame &frame);
+    void publishContacts(const Frame &frame,
                          visualization_msgs::Marker& msg);
 
-    void publishSet(const typename sample_set_t::ConstPtr &sample_set,
-                    const mesh_map_tree_t* map,
-                    const ros::Time& stamp);
+    void publishSet(const Frame &frame);
+    void publishProbabilities(const Frame &frame);
+    void aggregateVertices(const Frame &frame);
     void publishDiscretePoints(const std::vector<std::pair<int, double>>& labels,
                                const ros::Time& stamp,
                                visualization_msgs::Marker& msg);
@@ -48,7 +48,8 @@ public:
 
     void reportLikelyHoodOfGt(const typename sample_set_t::ConstPtr &sample_set,
                               const ContactSample& gt,
-                              const cslibs_mesh_map::MeshMapTree* map);
+                              const cslibs_mesh_map::MeshMapTree* map,
+                              const KinematicSnapshot& kinematics);
 
     const cslibs_kdl::KDLTransformation& getLabledPoint(int label) const;
 
@@ -5,35 +5,55 @@
 #include <memory>
 #include <cslibs_math_3d/linear/transform.hpp>
 #include <unordered_map>
-
+#include <limits>
+
+/**
+ * @brief Static transform tree compiled into flat arrays. Frames are mapped to
+ *        integer ids once in setup and every frame caches its transform to the
+ *        root, so a query is a single composition t_T_s = root_T_t^-1 * root_T_s.
+ *        If a child frame is given more than once, the last transform wins.
+ */
 class TransformGraph
 {
 public:
+    using id_t               = std::size_t;
+    using transform_t        = cslibs_math_3d::Transform3d;
+    using transform_vector_t = std::vector<transform_t, Eigen::aligned_allocator<transform_t>>;
+
+    static constexpr id_t INVALID = std::numeric_limits<id_t>::max();
+
     TransformGraph();
 
     bool setup(const std::vector<tf::StampedTransform> &transforms);
-    bool query(const std::string &target, const std::string &source, cslibs_math_3d::Transform3d &t_T_s);
 
-private:
-    struct EIGEN_ALIGN16 Node {
-        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-
-        using Ptr = std::shared_ptr<Node>;
+    /// INVALID for unknown frames
+    id_t id(const std::string &frame_id) const;
 
-        Ptr                         parent;
-        std::map<std::string, Ptr>  children;
-        std::string                 frame_id;
-        cslibs_math_3d::Transform3d transform_to_parent;
+    bool query(const std::string &target, const std::string &source, transform_t &t_T_s) const;
+    bool query(const id_t target, const id_t source, transform_t &t_T_s) const;
 
-        Node() = default;
+    /// t_T_s[i] = targets[i] <- sources[i], returns false if any frame is unknown,
+    /// found[i] tells which queries could be resolved
+    bool query(const std::vector<std::string> &targets,
+               const std::vector<std::string> &sources,
+               transform_vector_t             &t_T_s,
+               std::vector<uint8_t>           &found) const;
 
-        virtual ~Node()
-        {
-        }
-    };
+    /// cached transform from the root to the frame
+    inline const transform_t& rootTransform(const id_t frame) const
+    {
+        return root_T_frame_[frame];
+    }
 
-    Node::Ptr tree_;
+    inline std::size_t size() const
+    {
+        return frame_ids_.size();
+    }
 
+private:
+    std::unordered_map<std::string, id_t> ids_;
+    std::vector<std::string>              frame_ids_;
+    transform_vector_t                    root_T_frame_;
 };
 
 #endif // TRANSFORM_GRAPH_H
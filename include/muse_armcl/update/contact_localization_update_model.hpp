@@ -31,6 +31,7 @@ public:
         using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
         //        using mesh_map_t      = cslibs_mesh_map::MeshMap;
         const mesh_map_tree_t* map = ss->as<MeshMap>().data();
+        compiled_ = ss->as<MeshMap>().compiled();
         const JointStateData &joint_states = data->as<JointStateData>();
         const time_t time_frame = data->timeFrame().end;
 
@@ -58,9 +59,9 @@ public:
         last_ext_torques_ = tau_sensed;
         last_ext_torques_norm_ = tau_s_norm;
 
-        // update transformations in the map and derive jacobians
-        std::map<std::size_t, Eigen::MatrixXd> jacobians;
-        std::map<std::size_t, KDL::Frame> transforms;
+        // derive link transformations and jacobians into a new snapshot, the shared tree is not written
+        KinematicSnapshot::jacobian_vector_t jacobians;
+        KinematicSnapshot::frame_vector_t transforms;
         for(const mesh_map_tree_node_t::Ptr& partial_map : *map){
             std::string frame_id = partial_map->frameId();
             std::string parent;
@@ -68,19 +69,19 @@ public:
             if(!partial_map->parentFrameId(parent)){
                 parent = frame_id;
             }
-            KDL::Frame p_T_li = model_.getFKPose(joint_states.position, parent, frame_id);
-            cslibs_math_3d::Vector3d trans(p_T_li.p.x(),p_T_li.p.y(), p_T_li.p.z());
-            double x,y,z,w;
-            p_T_li.M.GetQuaternion(x,y,z,w);
-            cslibs_math_3d::Quaterniond q(x,y,z,w);
-            cslibs_math_3d::Transform3d transform(trans,q);
-            partial_map->update(transform);
-            Eigen::MatrixXd jac;
-            model_.getGeometricJacobianTransposed(joint_states.position, frame_id, jac);
             std::size_t map_id = partial_map->mapId();
-            jacobians[map_id] = jac;
-            transforms[map_id] = p_T_li;
+            if(map_id >= transforms.size()){
+                transforms.resize(map_id + 1, KDL::Frame::Identity());
+                jacobians.resize(map_id + 1);
+            }
+            transforms[map_id] = model_.getFKPose(joint_states.position, parent, frame_id);
+            model_.getGeometricJacobianTransposed(joint_states.position, frame_id, jacobians[map_id]);
         }
+        const MeshMap &mesh_map = ss->as<MeshMap>();
+        const KinematicSnapshot::ConstPtr kinematics =
+                KinematicSnapshot::build(*map, std::move(transforms), std::move(jacobians),
+                                         time_frame, mesh_map.nextSnapshotVersion());
+        mesh_map.publishSnapshot(kinematics);
 
         if(tau_s_norm < update_threshold_){
             particle_filter_reset_(time_frame);
@@ -93,16 +94,31 @@ public:
             const state_t& state = it.state();
 
             /// apply estimated weight on particle
-            *it *= calculateWeight(state, tau_sensed, map, jacobians, transforms);
+            *it *= calculateWeight(state, tau_sensed, *kinematics);
         }
 //        std::cout << "update done; took: " << (ros::Time::now() - start).toNSec() * 1e-6 << "ms\n";
     }
 
+    /// kinematics is the snapshot of the joint state the weights are computed for
     virtual double calculateWeight(const state_t& state,
                                    const Eigen::VectorXd& torques_ext_sensed,
-                                   const cslibs_mesh_map::MeshMapTree* map,
-                                   const std::map<std::size_t, Eigen::MatrixXd>& jacobianans,
-                                   const std::map<std::size_t, KDL::Frame>& transforms) = 0;
+                                   const KinematicSnapshot& kinematics) = 0;
+
+    /// contact point and surface normal of a particle, read from the compiled map if available
+    inline void surface(const state_t &state,
+                        const cslibs_mesh_map::MeshMap &map,
+                        cslibs_math_3d::Vector3d &pos,
+                        cslibs_math_3d::Vector3d &normal) const
+    {
+        const CompiledMeshMap *c = compiled_ ? compiled_->get(state.map_id) : nullptr;
+        if(c) {
+            pos    = c->position(state);
+            normal = c->normal(state);
+        } else {
+            pos    = state.getPosition(map);
+            normal = state.getNormal(map);
+        }
+    }
 
     virtual void setup(ros::NodeHandle &nh) override
     {
@@ -156,6 +172,7 @@ public:
 
 protected:
     bool first_iteration_;
+    const CompiledMeshMapTree* compiled_ = nullptr;
     cslibs_kdl::ExternalForcesSerialChain model_;
     std::vector<double> info_values_;
     Eigen::MatrixXd info_matrix_;
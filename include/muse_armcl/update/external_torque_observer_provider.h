@@ -0,0 +1,56 @@
+#ifndef EXTERNAL_TORQUE_OBSERVER_PROVIDER_H
+#define EXTERNAL_TORQUE_OBSERVER_PROVIDER_H
+
+#include <muse_armcl/update/joint_state_provider.h>
+
+#include <kdl/chain.hpp>
+#include <kdl/chaindynparam.hpp>
+#include <kdl/jntspaceinertiamatrix.hpp>
+
+#include <memory>
+
+namespace muse_armcl {
+/**
+ * @brief Joint state provider for raw joint states with measured joint torques.
+ *        A generalized momentum observer estimates the external torques of the
+ *        arm chain in the filter process and replaces the effort field, so no
+ *        separate observer node is needed. Time steps are taken from the
+ *        joint state stamps, i.e. the same time base as the filter.
+ */
+class EIGEN_ALIGN16 ExternalTorqueObserverProvider : public JointStateProvider
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t = Eigen::aligned_allocator<ExternalTorqueObserverProvider>;
+    using Ptr         = std::shared_ptr<ExternalTorqueObserverProvider>;
+
+protected:
+    virtual void doSetup(ros::NodeHandle &nh) override;
+    virtual bool process(JointStateData &data) override;
+
+private:
+    KDL::Chain                           chain_;
+    std::unique_ptr<KDL::ChainDynParam>  dynamics_;
+    std::vector<int>                     chain_index_;  /// joint state index of every chain joint
+    std::size_t                          chain_version_; /// mapping version chain_index_ was resolved for
+    Eigen::VectorXd                      gains_;
+    double                               max_dt_;
+
+    /// observer state
+    bool                                 initialized_;
+    cslibs_time::Time                    last_stamp_;
+    Eigen::VectorXd                      integral_;
+    Eigen::VectorXd                      p0_;
+    Eigen::VectorXd                      residual_;
+    Eigen::MatrixXd                      last_mass_;
+
+    /// preallocated KDL buffers
+    KDL::JntArray                        q_, qd_, tau_, coriolis_, gravity_;
+    KDL::JntSpaceInertiaMatrix           mass_;
+
+    bool resolveChain(const JointStateData &data);
+    void reset();
+};
+}
+
+#endif // EXTERNAL_TORQUE_OBSERVER_PROVIDER_H
@@ -4,6 +4,9 @@
 #include <cslibs_plugins_data/data.hpp>
 #include <sensor_msgs/JointState.h>
 
+#include <atomic>
+#include <memory>
+
 namespace muse_armcl {
 class EIGEN_ALIGN16 JointStateData : public cslibs_plugins_data::Data
 {
@@ -12,6 +15,15 @@ public:
     using allocator_t = Eigen::aligned_allocator<JointStateData>;
     using Ptr = std::shared_ptr<JointStateData>;
 
+    /// joint states received by one provider so far, shared with all data it created
+    struct Arrivals
+    {
+        using Ptr      = std::shared_ptr<Arrivals>;
+        using ConstPtr = std::shared_ptr<Arrivals const>;
+
+        std::atomic<uint64_t> count{0};
+    };
+
     JointStateData() = delete;
     inline JointStateData(const std::string              &frame,
                           const cslibs_time::TimeFrame   &time_frame,
@@ -28,10 +40,37 @@ public:
     {
     }
 
+    /// joint names set once, numeric arrays reserved for the number of joints
+    inline JointStateData(const std::vector<std::string> &_name) :
+        cslibs_plugins_data::Data("", cslibs_time::TimeFrame(), cslibs_time::Time()),
+        name(_name)
+    {
+        position.reserve(name.size());
+        velocity.reserve(name.size());
+        effort.reserve(name.size());
+    }
+
+    /// reuse a preallocated joint state for a new measurement, only the header is replaced
+    inline void reset(const std::string              &frame,
+                      const cslibs_time::TimeFrame   &time_frame,
+                      const cslibs_time::Time        &time_received)
+    {
+        static_cast<cslibs_plugins_data::Data&>(*this) = cslibs_plugins_data::Data(frame, time_frame, time_received);
+    }
+
     std::vector<std::string> name;
     std::vector<double>      position;
     std::vector<double>      velocity;
     std::vector<double>      effort;
+
+    uint64_t                 sequence = 0;  /// arrival number of this joint state
+    Arrivals::ConstPtr       arrivals;
+
+    /// joint states of the same provider that arrived after this one, i.e. are still waiting
+    inline uint64_t newer() const
+    {
+        return arrivals ? arrivals->count.load() - sequence : 0;
+    }
 };
 }
 
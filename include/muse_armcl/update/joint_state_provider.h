@@ -2,6 +2,7 @@
 #define JOINT_STATE_PROVIDER_H
 
 #include <muse_armcl/update/joint_state_data.hpp>
+#include <muse_armcl/common/clock.hpp>
 #include <cslibs_plugins_data/data_provider.hpp>
 
 namespace muse_armcl {
@@ -18,9 +19,30 @@ protected:
 
     ros::Duration   time_offset_;
     ros::Time       time_of_last_measurement_;
+    Clock           clock_;
+    JointStateData::Arrivals::Ptr arrivals_;
+
+    /// preallocated joint states handed out in ring order, a slot is free again
+    /// once the filter released its last reference to it
+    std::vector<JointStateData::Ptr> slots_;
+    std::size_t                      next_slot_;
+    std::size_t                      buffer_size_; /// 0 allocates every joint state
+    std::vector<std::string>         joint_names_; /// output order, message order if empty
+    std::vector<std::string>         names_;       /// output joint names of the resolved mapping
+    std::vector<int>                 index_;       /// message index of every output joint, -1 if missing
+    std::vector<std::string>         msg_names_;   /// message joint names the mapping was resolved for
+    bool                             resolved_;
+    std::size_t                      mapping_version_; /// incremented whenever the mapping is resolved again
 
     virtual void doSetup(ros::NodeHandle &nh) override;
 
+    /// hook for derived providers to modify a joint state before it is passed on, false drops it
+    virtual bool process(JointStateData &data);
+
+    void resolve(const sensor_msgs::JointState &msg);
+    JointStateData::Ptr acquire();
+    void copy(const std::vector<double> &src, std::vector<double> &dst) const;
+
 public:
     void callback(const sensor_msgs::JointStateConstPtr &msg);
 
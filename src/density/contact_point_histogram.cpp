@@ -34,6 +34,7 @@ namespace muse_armcl {
 
         ignore_func_ = nh.param(param_name("ignore_weight"), false);
         n_contacts_ = nh.param(param_name("number_of_contacts"), 10);
+        incremental_ = nh.param(param_name("incremental"), false);
 
         const std::string map_provider_id = nh.param<std::string>("map", ""); /// toplevel parameter
         if (map_provider_id == "")
@@ -46,152 +47,97 @@ namespace muse_armcl {
 
     }
 
-    void ContactPointHistogram::contacts(sample_vector_t &states) const
+    void ContactPointHistogram::rankLabels() const
     {
-        if(ranked_labels_.empty()){
+        top_k_.reset(n_contacts_);
+        for(const histogram_t::value_type& p : histo_){
+            /// equally hit labels prefer the closest representative
+            top_k_.push(p.second.hits, -p.second.dist, &p);
+        }
+    }
+
+    void ContactPointHistogram::contacts(sample_ptr_vector_t &states) const
+    {
+        if(histo_.empty()){
             return;
         }
         states.clear();
-        std::size_t min_element = std::min(n_contacts_, histo_.size());
-        auto it = ranked_labels_.rbegin();
-        ROS_INFO_STREAM("label: " << it->second.front());
-        while(states.size() < min_element && it != ranked_labels_.rend()){
-            std::size_t remaining = n_contacts_ - states.size();
-            if(it->second.size() > remaining){
-                std::map<double, std::vector<sample_t, sample_t::allocator_t>> cand2;
-                for(int label : it->second){
-                    try {
-                        const DiscreteCluster& c = histo_.at(label);
-                        cand2[c.dist].emplace_back(*c.sample);
-                    } catch (const std::exception &e) {
-                        std::cerr << "[ContactPointHistogram]: label " << label <<  " not found!" << std::endl;
-                        throw e;
-                    }
-                }
-
-                auto it2 = cand2.begin();
-                while(states.size() < min_element && it2 != cand2.end()){
-                    std::size_t remaining = n_contacts_ - states.size();
-                    if(it2->second.size() > remaining){
-                        states.insert(states.end(), it2->second.begin(), it2->second.begin() + remaining);
-                    } else{
-                        states.insert(states.end(), it2->second.begin(), it2->second.end());
-                    }
-                    ++it2;
-                }
-            } else{
-                for(int label : it->second){
-                    try {
-                        const DiscreteCluster& c = histo_.at(label);
-                        states.emplace_back(*(c.sample));
-                    } catch (const std::exception &e) {
-                        std::cerr << "[ContactPointHistogram]: label " << label <<  " not found!" << std::endl;
-                        throw e;
-                    }
-                }
-            }
-            ++it;
+        rankLabels();
+        const auto& ranked = top_k_.sorted();
+        if(ranked.empty()){
+            return;
+        }
+        ROS_DEBUG_STREAM("label: " << ranked.front().value->first);
+        for(const auto& entry : ranked){
+            states.emplace_back(entry.value->second.sample);
         }
-
     }
 
     void ContactPointHistogram::getTopLabels(std::vector<std::pair<int, double> > &labels) const
     {
         labels.clear();
-        std::size_t min_element = std::min(n_contacts_, histo_.size());
-        auto it = ranked_labels_.rbegin();
-        while(labels.size() < min_element && it != ranked_labels_.rend()){
-            std::size_t remaining = n_contacts_ - labels.size();
-            if(it->second.size() > remaining){
-                std::map<double, std::vector<int>> cand2;
-                for(int label : it->second){
-                    try {
-                        const DiscreteCluster& c = histo_.at(label);
-                        cand2[c.dist].emplace_back(label);
-                    } catch (const std::exception &e) {
-                        std::cerr << "[ContactPointHistogram]: label " << label <<  " not found!" << std::endl;
-                        throw e;
-                    }
-                }
-
-                auto it2 = cand2.begin();
-                while(labels.size() < min_element && it2 != cand2.end()){
-                    std::size_t remaining = n_contacts_ - labels.size();
-                    if(it2->second.size() > remaining){
-                        auto it3 = it2->second.begin();
-                        for(std::size_t i = 0; i < remaining; ++i){
-                            std::pair<int, double> p;
-                            p.first = *it3;
-                            try {
-                                p.second = histo_.at(*it3).sample->state.force;
-                                labels.emplace_back(p);
-                            } catch (const std::exception &e) {
-                                std::cerr << "[ContactPointHistogram]: label " << p.first  <<  " not found!" << std::endl;
-                                throw e;
-                            }
-                        }
-                    } else{
-                        for(auto l : it2->second){
-                            std::pair<int, double> p;
-                            p.first = l;
-                            try {
-                                p.second = histo_.at(l).sample->state.force;
-                                labels.emplace_back(p);
-                            } catch (const std::exception &e) {
-                                std::cerr << "[ContactPointHistogram]: label " << l <<  " not found!" << std::endl;
-                                throw e;
-                            }
-                        }
-                    }
-                    ++it2;
-                }
-            } else{
-                for(int label : it->second){
-                    std::pair<int, double> p;
-                    p.first = label;
-                    try {
-                        p.second = histo_.at(label).sample->state.force;
-                    } catch (std::exception &e) {
-                        std::cerr << "[ContactPointHistogram]: label " << label <<  " not found!" << std::endl;
-                        throw e;
-                    }
-                    labels.emplace_back(p);
-                }
-            }
-            ++it;
+        rankLabels();
+        for(const auto& entry : top_k_.sorted()){
+            labels.emplace_back(entry.value->first, entry.value->second.sample->state.force);
         }
     }
 
     void ContactPointHistogram::clear()
     {
-        histo_.clear();
-        ranked_labels_.clear();
+        if(incremental_){
+            /// keep the histogram, samples which did not move only apply their weight delta
+            slots_.begin();
+            dirty_labels_.clear();
+        } else {
+            histo_.clear();
+        }
     }
 
     void ContactPointHistogram::insert(const sample_t &sample)
+    {
+        if(incremental_){
+            insertIncremental(sample);
+            return;
+        }
+
+        int label;
+        double dist;
+        if(assignLabel(sample, label, dist)){
+            addHit(sample, label, dist, ignore_func_ ? 1.0 : sample.state.last_update);
+        }
+    }
+
+    void ContactPointHistogram::estimate()
+    {
+        if(incremental_){
+            settle();
+        }
+        /// labels are ranked on demand by contacts() and getTopLabels()
+    }
+
+    bool ContactPointHistogram::assignLabel(const sample_t &sample, int &label, double &dist) const
     {
         if(labeled_contact_points_.empty()){
             ROS_ERROR("No discrete contact points provided!");
-            return;
+            return false;
         }
         const muse_smc::StateSpace<StateSpaceDescription>::ConstPtr ss = map_provider_->getStateSpace();
         if (!ss->isType<MeshMap>())
-            return;
+            return false;
 
-        using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
         using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
-        const mesh_map_tree_t *map = ss->as<MeshMap>().data();
-        const mesh_map_tree_node_t* p_map = map->getNode(sample.state.map_id);
+        const KinematicSnapshot::ConstPtr kinematics = ss->as<MeshMap>().snapshot();
+        const mesh_map_tree_node_t* p_map = kinematics ? kinematics->node(sample.state.map_id) : nullptr;
         if(!p_map){
-            return;
+            return false;
         }
 
         if(sample.state.force < 0.01){
-            return;
+            return false;
         }
 
         std::string link = p_map->frameId();
-        cslibs_math_3d::Vector3d point =  sample.state.getPosition(p_map->map);
+        cslibs_math_3d::Vector3d point =  ss->as<MeshMap>().position(sample.state);
         //        cslibs_math_3d::Vector3d direction = baseTpred * p.state.getDirection(p_map->map);
         auto dist_sq = [point](const KDL::Vector& v){
             double d = 0;
@@ -216,24 +162,113 @@ namespace muse_armcl {
             std::cerr << "[ContactPointHistogram]: link " << link <<  " not found!" << std::endl;
             throw e;
         }
+        label = min_id;
+        dist  = min_d;
+        return true;
+    }
 
-        DiscreteCluster& cluster = histo_[min_id];
-        if(ignore_func_){
-          cluster.hits += 1.0;
-        } else {
-          cluster.hits += sample.state.last_update;
-        }
-        if(min_d < cluster.dist){
-            cluster.dist = min_d;
+    void ContactPointHistogram::addHit(const sample_t &sample, const int label, const double dist, const double hits)
+    {
+        DiscreteCluster& cluster = histo_[label];
+        cluster.hits += hits;
+        ++cluster.members;
+        if(dist < cluster.dist){
+            cluster.dist = dist;
             cluster.sample = &sample;
         }
     }
 
-    void ContactPointHistogram::estimate()
+    void ContactPointHistogram::removeHit(const SlotEntry &entry)
+    {
+        auto it = histo_.find(entry.label);
+        if(it == histo_.end()){
+            return;
+        }
+        DiscreteCluster& cluster = it->second;
+        cluster.hits -= entry.hits;
+        --cluster.members;
+        if(cluster.sample == entry.sample){
+            /// representative left, search a new one when settling
+            dirty_labels_.emplace_back(entry.label);
+        }
+    }
+
+    void ContactPointHistogram::insertIncremental(const sample_t &sample)
+    {
+        if(slots_.opening() && slots_.open(sample)){
+            /// the set was resampled, start over
+            histo_.clear();
+        }
+
+        bool known;
+        SlotEntry *entry = slots_.get(sample, known);
+        if(!entry){
+            int label;
+            double dist;
+            if(assignLabel(sample, label, dist)){
+                addHit(sample, label, dist, ignore_func_ ? 1.0 : sample.state.last_update);
+            }
+            return;
+        }
+
+        const double hits = ignore_func_ ? 1.0 : sample.state.last_update;
+        const SampleKey key(sample.state);
+        const bool counted = sample.state.force >= 0.01;
+        if(known && entry->key == key && entry->counted == counted){
+            /// same bin as before, only the weight changed
+            if(entry->counted){
+                histo_[entry->label].hits += hits - entry->hits;
+                entry->hits = hits;
+            }
+            return;
+        }
+
+        if(known && entry->counted){
+            removeHit(*entry);
+        }
+        entry->key     = key;
+        entry->sample  = &sample;
+        entry->hits    = hits;
+        entry->counted = assignLabel(sample, entry->label, entry->dist);
+        if(entry->counted){
+            addHit(sample, entry->label, entry->dist, hits);
+        }
+    }
+
+    void ContactPointHistogram::settle()
     {
-        ranked_labels_.clear();
-        for(const std::pair<double, DiscreteCluster>& p : histo_){
-            ranked_labels_[p.second.hits].emplace_back(p.first);
+        slots_.stale([this](SlotEntry &e){
+            if(e.counted){
+                removeHit(e);
+                e.counted = false;
+            }
+        });
+
+        if(!dirty_labels_.empty()){
+            for(int label : dirty_labels_){
+                auto it = histo_.find(label);
+                if(it != histo_.end()){
+                    it->second.dist   = std::numeric_limits<double>::max();
+                    it->second.sample = nullptr;
+                }
+            }
+            slots_.current([this](const SlotEntry &e){
+                if(!e.counted)
+                    return;
+                DiscreteCluster& cluster = histo_[e.label];
+                if(cluster.sample == nullptr || e.dist < cluster.dist){
+                    cluster.dist   = e.dist;
+                    cluster.sample = e.sample;
+                }
+            });
+            dirty_labels_.clear();
+        }
+
+        for(auto it = histo_.begin() ; it != histo_.end() ;){
+            if(it->second.members == 0)
+                it = histo_.erase(it);
+            else
+                ++it;
         }
     }
 }
@@ -15,6 +15,14 @@ void ContactPointHistogramMin::setup(const map_provider_map_t &map_providers, ro
     restrict_neigbours_ = nh.param(param_name("restrict_neigbours"), true);
     scale_pos_          = nh.param(param_name("scale_pos"), 1.0);
     scale_dir_          = nh.param(param_name("scale_dir"), 1.0);
+    /// labels are searched in base frame, every joint motion moves the bins
+    incremental_        = false;
+}
+
+void ContactPointHistogramMin::clear()
+{
+    ContactPointHistogram::clear();
+    label_groups_valid_ = false;
 }
 
 void ContactPointHistogramMin::insert(const sample_t &sample)
@@ -30,7 +38,15 @@ void ContactPointHistogramMin::insert(const sample_t &sample)
     using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
     using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
     const mesh_map_tree_t *map = ss->as<MeshMap>().data();
-    const mesh_map_tree_node_t* p_map = map->getNode(sample.state.map_id);
+    /// transforms are fixed for one insertion pass, labels only have to be moved to base once
+    if(!label_groups_valid_){
+        kinematics_ = ss->as<MeshMap>().snapshot();
+    }
+    /// base coordinates are unknown before the first update
+    if(!kinematics_){
+        return;
+    }
+    const mesh_map_tree_node_t* p_map = kinematics_->node(sample.state.map_id);
     if(!p_map){
         return;
     }
@@ -39,74 +55,107 @@ void ContactPointHistogramMin::insert(const sample_t &sample)
         return;
     }
 
-    std::string link = p_map->frameId();
-    cslibs_math_3d::Vector3d point =  sample.state.getPosition(p_map->map);
+    if(search_links_.empty()){
+        setupSearchLinks();
+        if(search_links_.empty()){
+            return;
+        }
+    }
+    if(!label_groups_valid_){
+        updateLabelGroups(*map);
+        label_groups_valid_ = true;
+    }
+    if(sample.state.map_id >= label_groups_.size()){
+        std::cerr << "[ContactPointHistogramMin]: link " << p_map->frameId() << " not found!" << std::endl;
+        throw std::runtime_error("[ContactPointHistogramMin]: link " + p_map->frameId() + " not found!");
+    }
+
+    cslibs_math_3d::Vector3d point =  ss->as<MeshMap>().position(sample.state);
     cslibs_math_3d::Vector3d dir =  sample.state.getDirection(p_map->map);
-    cslibs_math_3d::Transform3d base_T_sample = map->getTranformToBase(link);
+    const cslibs_math_3d::Transform3d &base_T_sample = kinematics_->baseTLink(sample.state.map_id);
     point = base_T_sample * point;
     dir   = base_T_sample * dir;
 
-    //        cslibs_math_3d::Vector3d direction = baseTpred * p.state.getDirection(p_map->map);
-    double scale_p = scale_pos_;
-    double scale_d = scale_dir_;
-    auto likelihood = [point, dir, scale_p, scale_d](const cslibs_math_3d::Vector3d& p,
-                                                  const cslibs_math_3d::Vector3d& v){
-        cslibs_math_3d::Vector3d dp = point -p;
-        cslibs_math_3d::Vector3d dd = dir - v;
-        double d = std::exp(-0.5* scale_p * dp.length2()) + std::exp(-0.5* scale_d * dd.length2());
-        return d;
-    };
+    const double px = point(0), py = point(1), pz = point(2);
+    const double dx = dir(0),   dy = dir(1),   dz = dir(2);
+    const double scale_p = -0.5 * scale_pos_;
+    const double scale_d = -0.5 * scale_dir_;
+
+    const LabelGroup &group = label_groups_[sample.state.map_id];
+    if(!group.missing.empty()){
+        std::cerr << "[ContactPointHistogramMin]: frame_id " << group.missing << " not found!" << std::endl;
+        throw std::runtime_error("[ContactPointHistogramMin]: frame_id " + group.missing + " not found!");
+    }
+    const double *c = group.points.data();
+    const std::size_t n = group.labels.size();
 
     double max_likelihood = std::numeric_limits<double>::min();
     int min_id = -1;
-
-    if(search_links_.empty()){
-        setupSearchLinks();
-        if(search_links_.empty()){
-            return;
+    for(std::size_t i = 0 ; i < n ; ++i, c += 6){
+        const double dp = (px - c[0]) * (px - c[0]) + (py - c[1]) * (py - c[1]) + (pz - c[2]) * (pz - c[2]);
+        const double dd = (dx - c[3]) * (dx - c[3]) + (dy - c[4]) * (dy - c[4]) + (dz - c[5]) * (dz - c[5]);
+        const double l_cp = std::exp(scale_p * dp) + std::exp(scale_d * dd);
+        if(l_cp > max_likelihood){
+            max_likelihood = l_cp;
+            min_id = group.labels[i];
         }
     }
-    try {
-        for(const std::string& frame_id: search_links_.at(link)){
-            try {
-                const std::vector<DiscreteContactPoint>& points = labeled_contact_points_.at(frame_id);
-                for(const DiscreteContactPoint& cp  : points){
-                    const KDL::Frame& f = cp.frame;
-                    cslibs_math_3d::Vector3d pos_cp (f.p(0), f.p(1), f.p(2));
-                    KDL::Vector dir_kdl = f.M * KDL::Vector(-1,0,0);
-                    cslibs_math_3d::Vector3d dir_cp(dir_kdl(0), dir_kdl(1), dir_kdl(2));
-                    cslibs_math_3d::Transform3d base_T_cp = map->getTranformToBase(frame_id);
-                    pos_cp = base_T_cp * pos_cp;
-                    dir_cp = base_T_cp * dir_cp;
-                    double l_cp = likelihood(pos_cp, dir_cp);
-
-                    if(l_cp > max_likelihood){
-                        max_likelihood = l_cp;
-                        min_id = cp.label;
-                    }
-                }
-            } catch (const std::exception &e) {
-                std::cerr << "[ContactPointHistogramMin]: frame_id " << frame_id << " not found!" << std::endl;
-                throw e;
-            }
 
-        }
-    } catch (const std::exception &e) {
-        std::cerr << "[ContactPointHistogramMin]: link " << link << " not found!" << std::endl;
-        throw e;
-    }
+    double fitness = std::fabs(2.0 - max_likelihood);
+    addHit(sample, min_id, fitness, ignore_func_ ? 1.0 : sample.state.last_update);
+}
 
+void ContactPointHistogramMin::updateLabelGroups(const cslibs_mesh_map::MeshMapTree &map)
+{
+    using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
 
-    double fitness = std::fabs(2.0 - max_likelihood);
-    DiscreteCluster& cluster = histo_[min_id];
-    if(ignore_func_){
-      cluster.hits += 1.0;
-    } else {
-      cluster.hits += sample.state.last_update;
+    /// every labelled point is transformed exactly once, labels of frames outside the
+    /// mesh map are never searched, since the search links only contain map frames
+    std::map<std::string, std::vector<double>> base_points;
+    for(const auto& l : labeled_contact_points_){
+        const mesh_map_tree_node_t *node = map.getNode(l.first);
+        if(!node){
+            continue;
+        }
+        const cslibs_math_3d::Transform3d &base_T_cp = kinematics_->baseTLink(node->mapId());
+        std::vector<double> &points = base_points[l.first];
+        points.reserve(6 * l.second.size());
+        for(const DiscreteContactPoint& cp : l.second){
+            const KDL::Frame& f = cp.frame;
+            KDL::Vector dir_kdl = f.M * KDL::Vector(-1,0,0);
+            const cslibs_math_3d::Vector3d pos_cp = base_T_cp * cslibs_math_3d::Vector3d(f.p(0), f.p(1), f.p(2));
+            const cslibs_math_3d::Vector3d dir_cp = base_T_cp * cslibs_math_3d::Vector3d(dir_kdl(0), dir_kdl(1), dir_kdl(2));
+            points.insert(points.end(), {pos_cp(0), pos_cp(1), pos_cp(2),
+                                         dir_cp(0), dir_cp(1), dir_cp(2)});
+        }
     }
-    if(fitness < cluster.dist){
-        cluster.dist = fitness;
-        cluster.sample = &sample;
+
+    label_groups_.resize(map.getNumberOfNodes());
+    for(const mesh_map_tree_node_t::Ptr& partial_map : map){
+        const std::string link = partial_map->frameId();
+        if(partial_map->mapId() >= label_groups_.size())
+            label_groups_.resize(partial_map->mapId() + 1);
+
+        LabelGroup &group = label_groups_[partial_map->mapId()];
+        group.points.clear();
+        group.labels.clear();
+        group.missing.clear();
+        auto search = search_links_.find(link);
+        if(search == search_links_.end()){
+            group.missing = link;
+            continue;
+        }
+        for(const std::string& frame_id: search->second){
+            auto points = labeled_contact_points_.find(frame_id);
+            if(points == labeled_contact_points_.end()){
+                group.missing = frame_id;
+                break;
+            }
+            const std::vector<double> &base = base_points.at(frame_id);
+            group.points.insert(group.points.end(), base.begin(), base.end());
+            for(const DiscreteContactPoint& cp : points->second)
+                group.labels.emplace_back(cp.label);
+        }
     }
 }
 
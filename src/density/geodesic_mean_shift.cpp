@@ -0,0 +1,340 @@
+#include <muse_armcl/density/sample_density.hpp>
+#include <muse_armcl/density/top_k.hpp>
+
+#include <queue>
+#include <unordered_map>
+
+namespace muse_armcl {
+/**
+ * @brief Weighted mean-shift on the mesh surface. Particle weights are accumulated
+ *        per vertex, every occupied vertex is shifted towards the kernel weighted
+ *        mean of its geodesic neighbourhood until it reaches a mode. The modes
+ *        themselves are returned as contacts.
+ */
+class EIGEN_ALIGN16 GeodesicMeanShift : public muse_armcl::SampleDensity
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t = Eigen::aligned_allocator<GeodesicMeanShift>;
+
+    using vertex_t          = cslibs_mesh_map::MeshMap::VertexHandle;
+    using mesh_map_tree_t   = cslibs_mesh_map::MeshMapTree;
+    using mesh_map_t        = cslibs_mesh_map::MeshMap;
+
+    /// geodesic neighbourhood of a vertex with precomputed kernel weights
+    struct Neighbourhood
+    {
+        bool                valid = false;
+        std::vector<int>    vertices;
+        std::vector<double> kernel;
+    };
+
+    /// particle mass collected on a vertex
+    struct VertexMass
+    {
+        double          weight = 0.0;
+        sample_t const* best   = nullptr;
+        int             mode   = -1;    /// memoized mode, -1 if not shifted yet
+    };
+
+    struct MapData
+    {
+        std::vector<Neighbourhood> neighbourhoods;
+        std::vector<VertexMass>    masses;
+        std::vector<int>           occupied;
+        std::vector<int>           shifted;
+    };
+
+    void setup(const map_provider_map_t &map_providers,
+               ros::NodeHandle &nh) override
+    {
+        auto param_name = [this](const std::string &name){return name_ + "/" + name;};
+
+        bandwidth_      = nh.param(param_name("bandwidth"), 0.02);
+        cutoff_         = nh.param(param_name("cutoff"), 3.0 * bandwidth_);
+        max_iterations_ = nh.param(param_name("max_iterations"), 20);
+        n_contacts_     = nh.param(param_name("number_of_contacts"), 10);
+        lazy_           = nh.param(param_name("lazy"), true);
+        mode_weight_threshold_ = nh.param(param_name("mode_weight_threshold"), 0.1);
+
+        const std::string map_provider_id = nh.param<std::string>("map", ""); /// toplevel parameter
+        if (map_provider_id == "")
+            throw std::runtime_error("[SampleDensity]: No map provider was found!");
+
+        if (map_providers.find(map_provider_id) == map_providers.end())
+            throw std::runtime_error("[SampleDensity]: Cannot find map provider '" + map_provider_id + "'!");
+
+        map_provider_ = map_providers.at(map_provider_id);
+    }
+
+    std::size_t histogramSize() const override
+    {
+        return n_occupied_;
+    }
+
+    void contacts(sample_ptr_vector_t &states) const override
+    {
+        ensureEstimated();
+
+        states.clear();
+        for(const sample_t &s : modes_) {
+            states.emplace_back(&s);
+        }
+    }
+
+    void clear() override
+    {
+        dirty_ = false;
+        for(MapData &m : maps_) {
+            for(const int v : m.occupied)
+                m.masses[v] = VertexMass();
+            for(const int v : m.shifted)
+                m.masses[v].mode = -1;
+            m.occupied.clear();
+            m.shifted.clear();
+        }
+        n_occupied_ = 0;
+        modes_.clear();
+    }
+
+    void insert(const sample_t &sample) override
+    {
+        const std::size_t map_id = sample.state.map_id;
+        const int id = sample.state.s < 0.5 ? sample.state.active_vertex.idx() : sample.state.goal_vertex.idx();
+        if(id < 0)
+            return;
+
+        if(map_id >= maps_.size())
+            maps_.resize(map_id + 1);
+        MapData &m = maps_[map_id];
+        if(static_cast<std::size_t>(id) >= m.masses.size())
+            m.masses.resize(id + 1);
+
+        VertexMass &v = m.masses[id];
+        if(v.best == nullptr) {
+            m.occupied.emplace_back(id);
+            ++n_occupied_;
+        }
+        v.weight += sample.weight;
+        if(v.best == nullptr || sample.weight > v.best->weight)
+            v.best = &sample;
+    }
+
+protected:
+    void doEstimate() override
+    {
+        const muse_smc::StateSpace<StateSpaceDescription>::ConstPtr ss = map_provider_->getStateSpace();
+        if (!ss->isType<MeshMap>())
+            return;
+
+        const mesh_map_tree_t *map = ss->as<MeshMap>().data();
+        const CompiledMeshMapTree *compiled = ss->as<MeshMap>().compiled();
+
+        /// mode vertex, basin mass and representative per map
+        struct Mode
+        {
+            std::size_t     map_id;
+            int             vertex;
+            double          mass;
+            double          density;
+            sample_t const* best;
+        };
+        std::vector<Mode> modes;
+
+        double max_mass = 0.0;
+        for(std::size_t map_id = 0 ; map_id < maps_.size() ; ++map_id) {
+            MapData &m = maps_[map_id];
+            if(m.occupied.empty())
+                continue;
+            const cslibs_mesh_map::MeshMapTreeNode *node = map->getNode(map_id);
+            if(!node)
+                continue;
+            const Mesh mesh{node->map, compiled ? compiled->get(map_id) : nullptr};
+
+            std::unordered_map<int, std::size_t> mode_index;
+            for(const int seed : m.occupied) {
+                const int mode = shift(mesh, m, seed);
+                auto it = mode_index.find(mode);
+                if(it == mode_index.end()) {
+                    it = mode_index.emplace(mode, modes.size()).first;
+                    modes.emplace_back(Mode{map_id, mode, 0.0, density(mesh, m, mode), nullptr});
+                }
+                Mode &md = modes[it->second];
+                const VertexMass &vm = m.masses[seed];
+                md.mass += vm.weight;
+                if(md.best == nullptr || vm.best->weight > md.best->weight)
+                    md.best = vm.best;
+                max_mass = std::max(max_mass, md.mass);
+            }
+        }
+
+        top_k_.reset(n_contacts_);
+        for(std::size_t i = 0 ; i < modes.size() ; ++i) {
+            if(modes[i].mass >= mode_weight_threshold_ * max_mass)
+                top_k_.push(modes[i].mass, modes[i].density, i);
+        }
+
+        /// a mode is reported as the representative particle moved onto the mode vertex
+        modes_.clear();
+        for(const auto &entry : top_k_.sorted()) {
+            const Mode &md = modes[entry.value];
+            const cslibs_mesh_map::MeshMapTreeNode *node = map->getNode(md.map_id);
+            sample_t s = *md.best;
+            s.state.active_vertex = node->map.vertexHandle(md.vertex);
+            s.state.goal_vertex   = s.state.active_vertex;
+            s.state.s             = 0.0;
+            s.weight              = md.mass;
+            modes_.emplace_back(s);
+        }
+    }
+
+private:
+    MeshMapProvider::Ptr                    map_provider_;
+    double                                  bandwidth_;
+    double                                  cutoff_;
+    int                                     max_iterations_;
+    std::size_t                             n_contacts_;
+    double                                  mode_weight_threshold_;
+
+    std::vector<MapData>                    maps_;
+    std::size_t                             n_occupied_ = 0;
+    sample_vector_t                         modes_;
+    TopK<std::size_t>                       top_k_;
+
+    /// link geometry, the compiled view is used if available
+    struct Mesh
+    {
+        const mesh_map_t      &map;
+        const CompiledMeshMap *compiled;
+
+        inline cslibs_math_3d::Vector3d point(const int v) const
+        {
+            return compiled ? compiled->point(static_cast<CompiledMeshMap::index_t>(v)) :
+                              map.getPoint(map.vertexHandle(v));
+        }
+
+        /// call fn(neighbour, edge length) for the one ring of a vertex
+        template <typename fn_t>
+        inline void neighbours(const int v, const fn_t &fn) const
+        {
+            if(compiled) {
+                const CompiledMeshMap::index_t i = static_cast<CompiledMeshMap::index_t>(v);
+                for(CompiledMeshMap::index_t a = compiled->adjacency_offsets[i] ; a < compiled->adjacency_offsets[i + 1] ; ++a)
+                    fn(static_cast<int>(compiled->adjacency[a]), compiled->edge_length[compiled->adjacency_edges[a]]);
+                return;
+            }
+            const vertex_t vh = map.vertexHandle(v);
+            const cslibs_math_3d::Vector3d p = map.getPoint(vh);
+            for(const vertex_t &nh : map.getNeighbors(vh))
+                fn(nh.idx(), (map.getPoint(nh) - p).length());
+        }
+    };
+
+    /// geodesic neighbourhood by Dijkstra over the mesh edges, computed once per vertex
+    const Neighbourhood& neighbourhood(const Mesh &mesh, MapData &m, const int id)
+    {
+        if(static_cast<std::size_t>(id) >= m.neighbourhoods.size())
+            m.neighbourhoods.resize(id + 1);
+        Neighbourhood &n = m.neighbourhoods[id];
+        if(n.valid)
+            return n;
+
+        using entry_t = std::pair<double, int>;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+        std::unordered_map<int, double> distances;
+        open.emplace(0.0, id);
+        distances[id] = 0.0;
+
+        const double h_inv_sq = 1.0 / (bandwidth_ * bandwidth_);
+        while(!open.empty()) {
+            const entry_t e = open.top();
+            open.pop();
+            if(e.first > distances[e.second])
+                continue;
+
+            n.vertices.emplace_back(e.second);
+            n.kernel.emplace_back(std::exp(-0.5 * e.first * e.first * h_inv_sq));
+
+            mesh.neighbours(e.second, [&](const int nh, const double length) {
+                const double d = e.first + length;
+                if(d > cutoff_)
+                    return;
+                auto it = distances.find(nh);
+                if(it == distances.end() || d < it->second) {
+                    distances[nh] = d;
+                    open.emplace(d, nh);
+                }
+            });
+        }
+        n.valid = true;
+        return n;
+    }
+
+    inline double mass(const MapData &m, const int id) const
+    {
+        return static_cast<std::size_t>(id) < m.masses.size() ? m.masses[id].weight : 0.0;
+    }
+
+    double density(const Mesh &mesh, MapData &m, const int id)
+    {
+        const Neighbourhood &n = neighbourhood(mesh, m, id);
+        double f = 0.0;
+        for(std::size_t i = 0 ; i < n.vertices.size() ; ++i)
+            f += n.kernel[i] * mass(m, n.vertices[i]);
+        return f;
+    }
+
+    /// shift a vertex until it stays put, the vertex closest to the weighted mean is taken as next position
+    int shift(const Mesh &mesh, MapData &m, const int seed)
+    {
+        std::vector<int> path;
+        int current = seed;
+        for(int i = 0 ; i < max_iterations_ ; ++i) {
+            if(static_cast<std::size_t>(current) < m.masses.size() && m.masses[current].mode >= 0) {
+                current = m.masses[current].mode;
+                break;
+            }
+            path.emplace_back(current);
+
+            const Neighbourhood &n = neighbourhood(mesh, m, current);
+            cslibs_math_3d::Vector3d mean(0.0, 0.0, 0.0);
+            double weight = 0.0;
+            for(std::size_t j = 0 ; j < n.vertices.size() ; ++j) {
+                const double w = n.kernel[j] * mass(m, n.vertices[j]);
+                if(w <= 0.0)
+                    continue;
+                mean    = mean + mesh.point(n.vertices[j]) * w;
+                weight += w;
+            }
+            if(weight <= 0.0)
+                break;
+            mean = mean * (1.0 / weight);
+
+            int next = current;
+            double min_dist = std::numeric_limits<double>::max();
+            for(const int v : n.vertices) {
+                const double d = (mesh.point(v) - mean).length2();
+                if(d < min_dist) {
+                    min_dist = d;
+                    next = v;
+                }
+            }
+            if(next == current)
+                break;
+            current = next;
+        }
+
+        /// memoize the mode along the path for the remaining seeds
+        for(const int v : path) {
+            if(static_cast<std::size_t>(v) >= m.masses.size())
+                m.masses.resize(v + 1);
+            m.masses[v].mode = current;
+            m.shifted.emplace_back(v);
+        }
+        return current;
+    }
+};
+}
+
+#include <class_loader/class_loader_register_macro.h>
+CLASS_LOADER_REGISTER_CLASS(muse_armcl::GeodesicMeanShift, muse_armcl::SampleDensity)
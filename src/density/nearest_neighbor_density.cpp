@@ -1,4 +1,5 @@
 #include <muse_armcl/density/sample_density.hpp>
+#include <muse_armcl/density/top_k.hpp>
 
 #include <unordered_map>
 #include <cslibs_math/statistics/weighted_distribution.hpp>
@@ -57,6 +58,7 @@ public:
         relative_weight_threshold_ = nh.param(param_name("relative_weight_threshold"), 0.8);
         n_contacts_                = nh.param(param_name("number_of_contacts"), 10);
         min_cluster_size_          = nh.param(param_name("min_cluster_size"), 10);
+        lazy_                      = nh.param(param_name("lazy"), true);
 
         const std::string map_provider_id = nh.param<std::string>("map", ""); /// toplevel parameter
         if (map_provider_id == "")
@@ -75,9 +77,12 @@ public:
         return vertex_distributions_.size();
     }
 
-    void publishClusters(const cslibs_mesh_map::MeshMapTree* map) const
+    void publishClusters(const MeshMap &mesh_map) const
     {
         std::shared_ptr<cslibs_math_3d::PointcloudRGB3d> part_cloud(new cslibs_math_3d::PointcloudRGB3d);
+        const KinematicSnapshot::ConstPtr kinematics = mesh_map.snapshot();
+        if (!kinematics)
+            return;
         /// publish all particles
 
         for(auto &c : clusters_) {
@@ -86,11 +91,8 @@ public:
                 if(c.second->samples.size() < min_cluster_size_)
                     continue;
 
-                const cslibs_mesh_map::MeshMapTreeNode* p_map = map->getNode(s->state.map_id);
-                if (p_map) {
-                    cslibs_math_3d::Transform3d T = map->getTranformToBase(p_map->map.frame_id_);
-                    cslibs_math_3d::Point3d pos = s->state.getPosition(p_map->map);
-                    pos = T * pos;
+                if (kinematics->node(s->state.map_id)) {
+                    cslibs_math_3d::Point3d pos = kinematics->baseTLink(s->state.map_id) * mesh_map.position(s->state);
                     cslibs_math_3d::PointRGB3d point(pos, 0.9f, ccolor);
                     part_cloud->insert(point);
                 }
@@ -98,21 +100,22 @@ public:
         }
         sensor_msgs::PointCloud2 cloud;
         cslibs_math_ros::sensor_msgs::conversion_3d::from<double>(part_cloud, cloud);
-        cloud.header.frame_id = map->front()->frameId();
+        cloud.header.frame_id = mesh_map.data()->front()->frameId();
         cloud.header.stamp = ros::Time::now();
         pub_.publish(cloud);
     }
 
-    void contacts(sample_vector_t &states) const override
+    void contacts(sample_ptr_vector_t &states) const override
     {
+        ensureEstimated();
+
         const muse_smc::StateSpace<StateSpaceDescription>::ConstPtr ss = map_provider_->getStateSpace();
         if (!ss->isType<MeshMap>())
             return;
 
-        using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
-        const mesh_map_tree_t *map = ss->as<MeshMap>().data();
+        const MeshMap &mesh_map = ss->as<MeshMap>();
 
-        auto get_nearest = [&map](const cluster_distribution &c, double& likely, double& sum_weight)
+        auto get_nearest = [&mesh_map](const cluster_distribution &c, double& likely, double& sum_weight)
         {
             double min_distance = std::numeric_limits<double>::max();
             sum_weight = 0;
@@ -120,7 +123,7 @@ public:
             sample_t const * sample = nullptr;
             const Eigen::Vector3d mean = c.distribution.getMean();
             for(const sample_t* s : c.samples) {
-                const Eigen::Vector3d pos =  s->state.getPosition(map->getNode(s->state.map_id)->map);
+                const Eigen::Vector3d pos =  mesh_map.position(s->state);
                 const double distance = (mean - pos).squaredNorm();
                 //                std::cout << s->state.map_id << std::endl;
                 sum_weight += s->weight;
@@ -155,8 +158,7 @@ public:
         ///  mean cluster weights ...
 
 
-//        std::map<double, std::map<double, std::map<std::size_t,std::vector<sample_t>>>> candidates;
-        std::map<double, std::vector<sample_t, sample_t::allocator_t>> candidates;
+        top_k_.reset(n_contacts_);
         for(auto &c : clusters_) {
             if(c.second->samples.size() < min_cluster_size_)
                 continue;
@@ -169,43 +171,21 @@ public:
             double likely = 0;
             sample_t const * s = get_nearest(*c.second, likely, weight);
             if( s != nullptr){
-                candidates[weight]/*[weight][c.second->samples.size()]*/.emplace_back(*s);
-                //                states.emplace_back(*s);
-//                std::cout << c.first << " " << weight  << " " << c.second->samples.size() << std::endl;
+                top_k_.push(weight, s->state.last_update, s);
             }
         }
         states.clear();
-        auto it = candidates.rbegin();
-        while(states.size() < std::min(n_contacts_, clusters_.size()) && it != candidates.rend()){
-            std::size_t remaining = n_contacts_ - states.size();
-            if(it->second.size() > remaining){
-                std::map<double, std::vector<sample_t, sample_t::allocator_t>> cand2;
-                for(auto s  = it->second.begin(); s < it->second.end(); ++s){
-                    cand2[s->state.last_update].emplace_back(*s);
-                }
-
-                auto it2 = cand2.rbegin();
-                while(states.size() < std::min(n_contacts_, clusters_.size()) && it2 != cand2.rend()){
-                    std::size_t remaining = n_contacts_ - states.size();
-                    if(it2->second.size() > remaining){
-                        states.insert(states.end(), it2->second.begin(), it2->second.begin() + remaining);
-                    } else{
-                        states.insert(states.end(), it2->second.begin(), it2->second.end());
-                    }
-                    ++it2;
-                }
-            } else{
-                states.insert(states.end(), it->second.begin(), it->second.end());
-            }
-            ++it;
+        for(const auto &entry : top_k_.sorted()){
+            states.emplace_back(entry.value);
         }
 
 //        std::cout << " # clusters " << clusters_.size() << " # states: " << states.size() << std::endl;
-        publishClusters(map);
+        publishClusters(mesh_map);
     }
 
     void clear() override
     {
+        dirty_ = false;
         vertex_distributions_.clear();
         clusters_.clear();
         vertex_labels_.clear();
@@ -228,22 +208,21 @@ public:
         if (!ss->isType<MeshMap>())
             return;
 
-        using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
-        const mesh_map_tree_t *map = ss->as<MeshMap>().data();
-        const cslibs_math_3d::Vector3d pos = sample.state.getPosition(map->getNode(sample.state.map_id)->map);
+        const cslibs_math_3d::Vector3d pos = ss->as<MeshMap>().position(sample.state);
         d->distribution.add(pos.data(), sample.weight);
         d->samples.insert(&sample);
     }
 
-    void estimate() override
+protected:
+    void doEstimate() override
     {
-
         const muse_smc::StateSpace<StateSpaceDescription>::ConstPtr ss = map_provider_->getStateSpace();
         if (!ss->isType<MeshMap>())
             return;
 
         using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
         const mesh_map_tree_t *map = ss->as<MeshMap>().data();
+        const CompiledMeshMapTree *compiled = ss->as<MeshMap>().compiled();
         int cluster_id = 0;
         /// clustering by map
         for(auto &vd : vertex_distributions_) {
@@ -253,11 +232,10 @@ public:
                 if(d->cluster_id != 0)
                     continue;
 
-                const cslibs_mesh_map::MeshMapTreeNode* state_map = map->getNode(vd.first);
-                const auto& neighbors = state_map->map.getNeighbors(d->handle);
+                const std::vector<int>& neighbors = vertexNeighbors(map, compiled, vd.first, d->handle);
                 std::set<int> found_labels;
-                for(const auto& n : neighbors){
-                    int l = vertex_labels_[n.idx()];
+                for(const int n : neighbors){
+                    int l = vertex_labels_[n];
                     found_labels.emplace(l);
                 }
 
@@ -271,9 +249,9 @@ public:
                     cd->samples = d->samples;
                     cd->map_id = vd.first;
                     vertex_labels_[d->handle.idx()];
-                    for(const auto &n : neighbors) {
-                        vertex_labels_[n.idx()] = cluster_id;
-                        cd->vertex_ids.emplace(n.idx());
+                    for(const int n : neighbors) {
+                        vertex_labels_[n] = cluster_id;
+                        cd->vertex_ids.emplace(n);
                     }
                     cd->distribution = d->distribution;
                     cd->vertex_ids.emplace(d->handle.idx());
@@ -319,9 +297,9 @@ public:
                     large_cluster->distribution += d->distribution;
                     large_cluster->vertex_ids.emplace(d->handle.idx());
 
-                    for(const auto &n : neighbors) {
-                        vertex_labels_[n.idx()] = large_label;
-                        large_cluster->vertex_ids.emplace(n.idx());
+                    for(const int n : neighbors) {
+                        vertex_labels_[n] = large_label;
+                        large_cluster->vertex_ids.emplace(n);
                     }
                 }
             }
@@ -341,7 +319,26 @@ private:
     std::size_t                 n_contacts_;
     mutable ros::Publisher      pub_;
     int                         min_cluster_size_;
-
+    mutable TopK<sample_t const*> top_k_;
+    std::vector<int>            neighbors_;
+
+    /// one ring of a vertex, from the compiled map's adjacency if available
+    const std::vector<int>& vertexNeighbors(const cslibs_mesh_map::MeshMapTree *map,
+                                            const CompiledMeshMapTree *compiled,
+                                            const std::size_t map_id,
+                                            const cslibs_mesh_map::MeshMap::VertexHandle &handle)
+    {
+        neighbors_.clear();
+        const CompiledMeshMap *c = compiled ? compiled->get(map_id) : nullptr;
+        if(c) {
+            const CompiledMeshMap::index_t v = static_cast<CompiledMeshMap::index_t>(handle.idx());
+            neighbors_.assign(c->neighboursBegin(v), c->neighboursEnd(v));
+        } else {
+            for(const auto &n : map->getNode(map_id)->map.getNeighbors(handle))
+                neighbors_.emplace_back(n.idx());
+        }
+        return neighbors_;
+    }
 };
 }
 
@@ -1,6 +1,8 @@
 #include <muse_armcl/density/sample_density.hpp>
 #include <muse_armcl/density/indexation.hpp>
 #include <muse_armcl/density/cluster_data.hpp>
+#include <muse_armcl/density/top_k.hpp>
+#include <muse_armcl/density/sample_slots.hpp>
 
 #include <cslibs_indexed_storage/storage.hpp>
 #include <cslibs_indexed_storage/backend/simple/unordered_component_map.hpp>
@@ -39,7 +41,7 @@ public:
     using index_t               = indexation_t::index_t;
     using position_t            = indexation_t::position_t;
     using data_t                = ClusterData;
-    using sample_map_t          = typename clustering_t::sample_map_ranked_t;
+    using top_k_t               = TopK<const sample_t*>;
 
 //    using kd_tree_t            = cis::Storage<data_t, index_t, cis::backend::kdtree::KDTreeBuffered>;
     using kd_tree_t            = cis::Storage<data_t, index_t, cis::backend::simple::UnorderedComponentMap>;
@@ -56,6 +58,8 @@ public:
         const double clustering_weight_threshold_percentage = nh.param(param_name("clustering_weight_threshold"), 0.1);
          std::cout << "clustering_weight_threshold: "<< clustering_weight_threshold_percentage << std::endl;
         const std::size_t maximum_sample_size = static_cast<std::size_t>(nh.param<int>(param_name("maximum_sample_size"), 0));
+        incremental_ = nh.param(param_name("incremental"), false);
+        lazy_        = nh.param(param_name("lazy"), true);
 
         /// initialize indexation, kdtree, clustering
         indexation_ = indexation_t(resolution);
@@ -75,8 +79,16 @@ public:
 
     virtual void clear()
     {
+        dirty_ = false;
         clustering_.clear();
-        kdtree_->clear();
+        kinematics_.reset();
+        if (incremental_) {
+            /// keep the voxels, only samples that changed their voxel are moved
+            slots_.begin();
+        } else {
+            kdtree_->clear();
+            occupied_ = 0;
+        }
     }
 
     virtual void insert(const sample_t &sample)
@@ -85,90 +97,169 @@ public:
         if (!ss->isType<MeshMap>())
             return;
 
-        using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
-        const mesh_map_tree_t *map = ss->as<MeshMap>().data();
-        const auto map_sample = map->getNode(sample.state.map_id);
-        position_t pos = sample.state.getPosition(map_sample->map);
-        cslibs_math_3d::Transform3d base_T_sample = map->getTranformToBase(map_sample->frameId());
-        pos = base_T_sample * pos;
-        kdtree_->insert(indexation_.create(pos), data_t(sample, pos));
+        /// samples are placed in base coordinates, which are unknown before the first update
+        const MeshMap &mesh_map = ss->as<MeshMap>();
+        const KinematicSnapshot *kinematics = snapshot(mesh_map);
+        if (!kinematics || !kinematics->node(sample.state.map_id))
+            return;
+
+        if (!incremental_) {
+            const position_t pos = kinematics->baseTLink(sample.state.map_id) * mesh_map.position(sample.state);
+            insertVoxel(indexation_.create(pos), sample, pos);
+            return;
+        }
+
+        if (slots_.opening() && slots_.open(sample)) {
+            /// the set was resampled, start over
+            kdtree_->clear();
+            occupied_ = 0;
+        }
+
+        bool known;
+        SlotEntry *entry = slots_.get(sample, known);
+        if (!entry) {
+            const position_t pos = kinematics->baseTLink(sample.state.map_id) * mesh_map.position(sample.state);
+            insertVoxel(indexation_.create(pos), sample, pos);
+            return;
+        }
 
-        if (sample.weight > max_weight_)
-            max_weight_ = sample.weight;
+        const SampleKey key(sample.state);
+        if (!known || !(entry->key == key)) {
+            /// only moved samples touch the mesh
+            entry->key   = key;
+            entry->local = mesh_map.position(sample.state);
+        }
+        const position_t pos   = kinematics->baseTLink(sample.state.map_id) * entry->local;
+        const index_t    index = indexation_.create(pos);
+        if (known && entry->inserted && entry->index == index) {
+            updateVoxel(index, sample, pos);
+        } else {
+            if (known && entry->inserted)
+                removeVoxel(entry->index, &sample);
+            insertVoxel(index, sample, pos);
+        }
+        entry->index    = index;
+        entry->sample   = &sample;
+        entry->inserted = true;
     }
 
     virtual void estimate()
     {
-        clustering_.setMaxWeight(max_weight_);
-        kd_tree_clustering_t clustering(*kdtree_);
-        clustering.cluster(clustering_);
-        weight_threshold_ = weight_threshold_percentage_ * max_weight_;
-        max_weight_ = 0.0;
+        if (incremental_) {
+            slots_.stale([this](SlotEntry &e) {
+                if (e.inserted)
+                    removeVoxel(e.index, e.sample);
+                e.inserted = false;
+            });
+        }
+        SampleDensity::estimate();
     }
 
     virtual std::size_t histogramSize() const
     {
-        return kdtree_->size();
+        return occupied_;
     }
 
-    virtual void contacts(sample_vector_t &states) const override
+    virtual void contacts(sample_ptr_vector_t &states) const override
     {
-        const sample_map_t map = clustering_.getSamples();
-        std::size_t n_cluster = 0;
-        for(const auto& entry : map){
-            n_cluster += entry.second.size();
-        }
+        ensureEstimated();
+
+        top_k_.reset(n_contacts_);
+        clustering_.getSamples(top_k_);
 
         states.clear();
-        auto it = map.rbegin();
-        while(states.size() < std::min(n_contacts_, map.size()) && it != map.rend()){
-            std::size_t remaining = n_contacts_ - states.size();
-            if(it->second.size() > remaining){
-                std::map<double, std::vector<const sample_t*>> cand2;
-                for(std::vector<const sample_t*>::const_iterator s  = it->second.begin(); s < it->second.end(); ++s){
-                    double lu = (*s)->state.last_update;
-                    cand2[lu].emplace_back(*s);
-                }
-
-                auto it2 = cand2.rbegin();
-                while(states.size() < std::min(n_contacts_, n_cluster) && it2 != cand2.rend()){
-                    std::size_t remaining = n_contacts_ - states.size();
-                    if(it2->second.size() > remaining){
-                        for(std::size_t i = 0; i < remaining; ++i){
-                            states.emplace_back(*it2->second.at(i));
-                        }
-//                        states.insert(states.end(), it2->second.begin(), it2->second.begin() + remaining);
-                    } else{
-                        for(auto si : it2->second){
-                            states.emplace_back(*si);
-                        }
-//                        states.insert(states.end(), it2->second.begin(), it2->second.end());
-                    }
-                    ++it2;
-                }
-            } else{
-                for(auto si : it->second){
-                    states.emplace_back(*si);
-                }
-//                states.insert(states.end(), it->second.begin(), it->second.end());
-            }
-            ++it;
-        }
+        for (const auto &entry : top_k_.sorted())
+            states.emplace_back(entry.value);
+    }
+
+protected:
+    virtual void doEstimate() override
+    {
+        /// weights are read when clustering, so is the maximum
+        double max_weight = 0.0;
+        kdtree_->traverse([&max_weight](const index_t &, data_t &d) {
+            d.cluster = -1;
+            for (const auto &p : d.samples)
+                max_weight = std::max(max_weight, p.first->weight);
+        });
 
-//        for (const auto &entry : map)
-//            if (entry.second->weight > weight_threshold_)
-//                states.push_back(*entry.second);
+        clustering_.clear();
+        clustering_.setMaxWeight(max_weight);
+        kd_tree_clustering_t clustering(*kdtree_);
+        clustering.cluster(clustering_);
+        weight_threshold_ = weight_threshold_percentage_ * max_weight;
     }
 
 private:
+
+    /// incremental mode, voxel of every sample from the last pass
+    struct SlotEntry
+    {
+        SampleKey       key;
+        position_t      local;
+        index_t         index;
+        sample_t const* sample   = nullptr;
+        bool            inserted = false;
+    };
+
     MeshMapProvider::Ptr       map_provider_;
     double                     weight_threshold_percentage_;
     double                     weight_threshold_;
-    double                     max_weight_;
 
     indexation_t               indexation_;
     clustering_t               clustering_;
     std::shared_ptr<kd_tree_t> kdtree_;
+    std::size_t                occupied_ = 0;
     std::size_t                n_contacts_;
+    mutable top_k_t            top_k_;
+
+    bool                       incremental_;
+    SampleSlots<SlotEntry>     slots_;
+    KinematicSnapshot::ConstPtr kinematics_;
+
+    /// one insertion pass uses the link transforms of a single snapshot, nullptr before the first update
+    inline const KinematicSnapshot* snapshot(const MeshMap &map)
+    {
+        if (!kinematics_)
+            kinematics_ = map.snapshot();
+        return kinematics_.get();
+    }
+
+    inline void insertVoxel(const index_t &index, const sample_t &sample, const position_t &pos)
+    {
+        const data_t *d = kdtree_->get(index);
+        if (!d || d->samples.empty())
+            ++occupied_;
+        kdtree_->insert(index, data_t(sample, pos));
+    }
+
+    inline void updateVoxel(const index_t &index, const sample_t &sample, const position_t &pos)
+    {
+        data_t *d = kdtree_->get(index);
+        if (!d)
+            return;
+        for (auto &p : d->samples) {
+            if (p.first == &sample) {
+                p.second = pos;
+                return;
+            }
+        }
+    }
+
+    inline void removeVoxel(const index_t &index, const sample_t *sample)
+    {
+        data_t *d = kdtree_->get(index);
+        if (!d)
+            return;
+        for (auto it = d->samples.begin() ; it != d->samples.end() ; ++it) {
+            if (it->first == sample) {
+                *it = d->samples.back();
+                d->samples.pop_back();
+                if (d->samples.empty())
+                    --occupied_;
+                return;
+            }
+        }
+    }
 };
 }
@@ -3,6 +3,7 @@
 #include <ros/ros.h>
 #include <muse_armcl/evaluation/contact_evaluation_data.hpp>
 #include <muse_armcl/evaluation/data_set_loader.hpp>
+#include <muse_armcl/evaluation/binary_data_set.hpp>
 #include <muse_armcl/evaluation/msgs_conversion.hpp>
 #include <cslibs_kdl_conversion/cslibs_kdl_conversion.h>
 #include <cslibs_kdl/yaml_to_kdl_tranform.h>
@@ -32,18 +33,31 @@ int main(int argc, char *argv[])
     std::vector<std::string> topics = {{nh.param<std::string>("tf", "/first_tf"),
                                         nh.param<std::string>("joint", "/contact_data")}};
 
-    std::string bag_file = nh.param<std::string>("bag_file","");
-    if(bag_file == ""){
+    std::string bag_file  = nh.param<std::string>("bag_file","");
+    std::string data_file = nh.param<std::string>("data_file","");
+    if(bag_file == "" && data_file == ""){
         ROS_ERROR("No bag file provided. Shutting done");
         return 41;
     }
-    rosbag::Bag bag(bag_file);
-    rosbag::View view(bag, rosbag::TopicQuery(topics));
-
-    std::cout << view.getBeginTime() << "\n";
 
     muse_armcl::DataSet data_set;
-    bool success = muse_armcl::DataSetLoader::loadFromBag(bag, topics[0], topics[1], data_set);
+    bool success = false;
+    if(data_file != ""){
+        /// preprocessed data set, no bag involved
+        try {
+            muse_armcl::BinaryDataSet binary(data_file);
+            success = binary.load(data_set);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+        }
+    } else {
+        rosbag::Bag bag(bag_file);
+        rosbag::View view(bag, rosbag::TopicQuery(topics));
+
+        std::cout << view.getBeginTime() << "\n";
+
+        success = muse_armcl::DataSetLoader::loadFromBag(bag, topics[0], topics[1], data_set);
+    }
     std::cout << (success ? " loaded data successfully" : " loading data failed") << std::endl;
 
     if(!success){
@@ -0,0 +1,82 @@
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <ros/ros.h>
+#include <muse_armcl/evaluation/binary_data_set.hpp>
+
+using namespace muse_armcl;
+
+/// converts a data set bag once into the binary data set format read by the offline nodes
+int main(int argc, char *argv[])
+{
+    ros::init(argc, argv, "muse_armcl_data_set_converter");
+    ros::NodeHandle nh("~");
+
+    const std::string topic_tf      = nh.param<std::string>("tf", "/first_tf");
+    const std::string topic_contact = nh.param<std::string>("joint", "/contact_data");
+    const std::string bag_file      = nh.param<std::string>("bag_file", "");
+    const std::string data_file     = nh.param<std::string>("data_file", "");
+    if(bag_file == "" || data_file == ""){
+        ROS_ERROR("bag_file and data_file have to be provided. Shutting down");
+        return 41;
+    }
+
+    rosbag::Bag bag;
+    try {
+        bag.open(bag_file, rosbag::bagmode::Read);
+    } catch (std::exception &e) {
+        ROS_ERROR_STREAM("Could not load bagfile " + bag_file + "!");
+        return 42;
+    }
+    rosbag::View view(bag, rosbag::TopicQuery(std::vector<std::string>{topic_tf, topic_contact}));
+
+    BinaryDataSetWriter writer(data_file);
+    if(!writer.good()){
+        ROS_ERROR_STREAM("Cannot write " + data_file + "!");
+        return 43;
+    }
+
+    /// a tf message and a contact sequence with the same bag time form one sequence, like in the loaders
+    tf::tfMessage::ConstPtr tf;
+    jaco2_contact_msgs::Jaco2CollisionSequence::ConstPtr sequence;
+    uint64_t time = 0;
+    std::size_t count = 0;
+    auto flush = [&]() {
+        if(!tf && !sequence)
+            return true;
+        if(!writer.write(time, tf.get(), sequence.get()))
+            return false;
+        tf.reset();
+        sequence.reset();
+        ++count;
+        return true;
+    };
+
+    for(const rosbag::MessageInstance &m : view) {
+        const uint64_t nsecs = m.getTime().toNSec();
+        const bool is_tf = m.getTopic() == topic_tf;
+        if((tf || sequence) && (nsecs != time || (is_tf ? tf != nullptr : sequence != nullptr))) {
+            if(!flush()) {
+                ROS_ERROR_STREAM("Failed to write sequence " << count << "!");
+                return 44;
+            }
+        }
+        time = nsecs;
+        if(is_tf) {
+            tf = m.instantiate<tf::tfMessage>();
+            if(!tf)
+                std::cerr << "Cannot instantiate tf::tfMessage!" << std::endl;
+        } else {
+            sequence = m.instantiate<jaco2_contact_msgs::Jaco2CollisionSequence>();
+            if(!sequence)
+                std::cerr << "Cannot instantiate jaco2_contact_msgs::Jaco2CollisionSequence!" << std::endl;
+        }
+    }
+    if(!flush() || !writer.close()) {
+        ROS_ERROR_STREAM("Failed to write " + data_file + "!");
+        return 44;
+    }
+    bag.close();
+
+    ROS_INFO_STREAM("Converted " << count << " sequences to " << data_file << ".");
+    return 0;
+}
@@ -6,7 +6,18 @@ namespace muse_armcl {
 MuseARMCLNode::MuseARMCLNode() :
     nh_private_("~"),
     tf_provider_frontend_(new tf_listener_t),
-    tf_provider_backend_(new tf_listener_t)
+    tf_provider_backend_(new tf_listener_t),
+    stop_(false)
+{
+}
+
+MuseARMCLNode::MuseARMCLNode(const ros::NodeHandle &nh_private,
+                             const ros::NodeHandle &nh_public) :
+    nh_private_(nh_private),
+    nh_public_(nh_public),
+    tf_provider_frontend_(new tf_listener_t),
+    tf_provider_backend_(new tf_listener_t),
+    stop_(false)
 {
 }
 
@@ -15,6 +26,26 @@ MuseARMCLNode::~MuseARMCLNode()
     for (auto &d : data_providers_) {
         d.second->disable();
     }
+    if (particle_filter_)
+        particle_filter_->end();
+}
+
+void MuseARMCLNode::stop()
+{
+    stop_ = true;
+    std::unique_lock<std::mutex> l(map_providers_mutex_);
+    for (auto &m : map_providers_)
+        m.second->stop();
+}
+
+bool MuseARMCLNode::waitForValidTime() const
+{
+    /// wait in slices, so an embedding process can abort the setup
+    while (!stop_ && ros::ok()) {
+        if (ros::Time::waitForValid(ros::WallDuration(0.1)))
+            return true;
+    }
+    return false;
 }
 
 bool MuseARMCLNode::setup()
@@ -50,6 +81,9 @@ bool MuseARMCLNode::setup()
         ROS_INFO_STREAM("[" << prediction_model_->getName() << "]");
     }
     {   /// Map Providers
+        std::unique_lock<std::mutex> l(map_providers_mutex_);
+        if (stop_)
+            return false;
         loader.load<MeshMapProvider, tf_provider_t::Ptr, ros::NodeHandle&>(
                     map_providers_, tf_provider_frontend_, nh_private_);
         if (map_providers_.empty()) {
@@ -162,7 +196,10 @@ bool MuseARMCLNode::setup()
             return false;
         }
 
-        ros::Time::waitForValid();
+        if (!waitForValidTime()) {
+            ROS_ERROR_STREAM("Setup was aborted while waiting for a valid time!");
+            return false;
+        }
 
         sample_set_.reset(new sample_set_t(world_frame,
                                            cslibs_time::Time(ros::Time::now().toNSec()),
@@ -218,21 +255,28 @@ bool MuseARMCLNode::setup()
     return true;
 }
 
-void MuseARMCLNode::start()
+bool MuseARMCLNode::start()
 {
     for (auto &d : data_providers_) {
         d.second->enable();
     }
 
     /// trigger uniform initialization
-    ros::Time::waitForValid();
+    if (!waitForValidTime()) {
+        ROS_ERROR_STREAM("Start was aborted while waiting for a valid time!");
+        return false;
+    }
     particle_filter_->requestUniformInitialization(time_t(ros::Time::now().toNSec()));
 
     if (!particle_filter_->start()) {
         ROS_ERROR_STREAM("Couldn't start the filter!");
-        return;
+        return false;
     }
+    return true;
+}
 
+void MuseARMCLNode::spin()
+{
     double node_rate = nh_private_.param<double>("node_rate", 60.0);
     if (node_rate == 0.0) {
         /// unlimited speed
@@ -312,17 +356,3 @@ bool MuseARMCLNode::getUpdateModelProviderMapping(update_model_mapping_t &update
     return true;
 }
 }
-
-int main(int argc, char *argv[])
-{
-    ros::init(argc, argv, "muse_armcl");
-
-    muse_armcl::MuseARMCLNode node;
-    if (node.setup()) {
-        ROS_INFO_STREAM("Node is set up and ready to start!");
-        node.start();
-    } else {
-        ROS_ERROR_STREAM("Could not set up the node!");
-    }
-    return 0;
-}
@@ -26,6 +26,9 @@
 
 #include <ros/ros.h>
 
+#include <atomic>
+#include <mutex>
+
 namespace muse_armcl {
 class EIGEN_ALIGN16 MuseARMCLNode
 {
@@ -33,10 +36,18 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     using allocator_t = Eigen::aligned_allocator<MuseARMCLNode>;
     MuseARMCLNode();
+    /// handles of the embedding process, e.g. of a nodelet
+    MuseARMCLNode(const ros::NodeHandle &nh_private,
+                  const ros::NodeHandle &nh_public);
     ~MuseARMCLNode();
 
-    inline bool setup();
-    inline void start();
+    bool setup();
+    /// enable the data providers and start the filter threads
+    bool start();
+    /// spin the callbacks of a standalone node
+    void spin();
+    /// abort a setup or start that waits for a valid time, e.g. on nodelet unload
+    void stop();
 
 private:
     using time_t                 = cslibs_time::Time;
@@ -89,6 +100,10 @@ private:
     SampleDensity::Ptr          sample_density_;
     StatePublisher::Ptr         state_publisher_;
 
+    std::atomic_bool            stop_;
+    std::mutex                  map_providers_mutex_;   /// stop may run while setup loads the map providers
+
+    bool waitForValidTime() const;
     bool getPredictionDataProvider(data_provider_t::Ptr &prediction_provider);
     bool getPredictionMapProvider(MeshMapProvider::Ptr &map_provider);
     bool getUpdateModelProviderMapping(update_model_mapping_t &update_mapping);
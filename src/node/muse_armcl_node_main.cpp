@@ -0,0 +1,16 @@
+#include "muse_armcl_node.h"
+
+int main(int argc, char *argv[])
+{
+    ros::init(argc, argv, "muse_armcl");
+
+    muse_armcl::MuseARMCLNode node;
+    if (node.setup()) {
+        ROS_INFO_STREAM("Node is set up and ready to start!");
+        if (node.start())
+            node.spin();
+    } else {
+        ROS_ERROR_STREAM("Could not set up the node!");
+    }
+    return 0;
+}
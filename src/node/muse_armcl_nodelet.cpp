@@ -0,0 +1,48 @@
+#include "muse_armcl_node.h"
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <thread>
+
+namespace muse_armcl {
+/**
+ * @brief The live node as a nodelet. Loaded into the same manager as the
+ *        torque observer and the controller, joint states and contacts are
+ *        passed as shared messages without serialization.
+ */
+class MuseARMCLNodelet : public nodelet::Nodelet
+{
+public:
+    virtual ~MuseARMCLNodelet()
+    {
+        if (node_)
+            node_->stop();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+private:
+    std::shared_ptr<MuseARMCLNode> node_;
+    std::thread                    worker_;
+
+    virtual void onInit() override
+    {
+        /// the multi threaded handles keep the filter callbacks off the manager's single thread queue
+        node_.reset(new MuseARMCLNode(getMTPrivateNodeHandle(), getMTNodeHandle()));
+
+        /// setup waits for the map and a valid time, onInit has to return right away
+        worker_ = std::thread([this]() {
+            if (!node_->setup()) {
+                NODELET_ERROR_STREAM("Could not set up the nodelet!");
+                return;
+            }
+            NODELET_INFO_STREAM("Nodelet is set up and ready to start!");
+            if (!node_->start())
+                NODELET_ERROR_STREAM("Could not start the nodelet!");
+        });
+    }
+};
+}
+
+PLUGINLIB_EXPORT_CLASS(muse_armcl::MuseARMCLNodelet, nodelet::Nodelet)
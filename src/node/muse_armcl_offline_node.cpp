@@ -35,21 +35,43 @@ bool MuseARMCLOfflineNode::setup()
     nh_private_.getParam("bag_filename",          bag_filename);
     nh_private_.getParam("bag_joint_state_topic", bag_joint_state_topic_);
     nh_private_.getParam("bag_tf_topic",          bag_tf_topic_);
-    std::shared_ptr<rosbag::Bag> bag;
-    try {
-        //        bag_.reset(new rosbag::Bag(bag_filename, rosbag::bagmode::Read));
-        bag.reset(new rosbag::Bag(bag_filename, rosbag::bagmode::Read));
-    } catch (std::exception &e) {
-        ROS_ERROR_STREAM("Could not load bagfile " + bag_filename + "!");
-        return false;
-    }
-    data_set_.reset(new muse_armcl::DataSet);
-    if(!muse_armcl::DataSetLoader::loadFromBag(*bag, bag_tf_topic_, bag_joint_state_topic_, *data_set_)){
-        ROS_ERROR_STREAM("Could not load data from bagfile " + bag_filename + "!");
-        return false;
+    const std::string data_file = nh_private_.param<std::string>("data_file", "");
+    if (!data_file.empty()) {
+        /// preprocessed data, sequences are decoded from the mapping one by one
+        try {
+            data_file_.reset(new BinaryDataSet(data_file));
+        } catch (std::exception &e) {
+            ROS_ERROR_STREAM(e.what());
+            return false;
+        }
+        ROS_INFO_STREAM("Data file mapped! " << data_file_->size() << " sequences.");
+    } else if (nh_private_.param<bool>("stream_data", false)) {
+        /// sequences are read one by one while the filter runs
+        try {
+            data_stream_.reset(new DataSetStream(bag_filename, bag_tf_topic_, bag_joint_state_topic_,
+                                                 static_cast<std::size_t>(std::max(1, nh_private_.param<int>("stream_prefetch", 1)))));
+        } catch (std::exception &e) {
+            ROS_ERROR_STREAM("Could not load bagfile " + bag_filename + "!");
+            return false;
+        }
+        ROS_INFO_STREAM("Streaming data, " << data_stream_->expectedSize() << " sequences expected.");
+    } else {
+        std::shared_ptr<rosbag::Bag> bag;
+        try {
+            //        bag_.reset(new rosbag::Bag(bag_filename, rosbag::bagmode::Read));
+            bag.reset(new rosbag::Bag(bag_filename, rosbag::bagmode::Read));
+        } catch (std::exception &e) {
+            ROS_ERROR_STREAM("Could not load bagfile " + bag_filename + "!");
+            return false;
+        }
+        data_set_.reset(new muse_armcl::DataSet);
+        if(!muse_armcl::DataSetLoader::loadFromBag(*bag, bag_tf_topic_, bag_joint_state_topic_, *data_set_)){
+            ROS_ERROR_STREAM("Could not load data from bagfile " + bag_filename + "!");
+            return false;
+        }
+        bag->close();
+        ROS_INFO_STREAM("Data successfully loaded! " << data_set_->size() << " sequences.");
     }
-    bag->close();
-    ROS_INFO_STREAM("Data successfully loaded! " << data_set_->size() << " sequences.");
 
 
     {   /// Update Models
@@ -258,93 +280,128 @@ void MuseARMCLOfflineNode::start()
         d.second->enable();
     }
 
-    std::shared_ptr<std::vector<tf::StampedTransform>>   tf_transforms;
-    std::size_t nv = data_set_->size();
+    std::size_t nv = data_file_ ? data_file_->size() : (data_stream_ ? data_stream_->expectedSize() : data_set_->size());
     std::size_t count = 0;
     std::size_t n_samples = 0;
     cslibs_time::Time start_time = cslibs_time::Time::now();
     std::string file = results_file_base_name_ + "_send_messages.txt";
 
-    for(ContactEvaluationSample& seq : *data_set_){
+    auto report = [&](const ContactEvaluationSample &seq) {
         std::ofstream of(file);
-
-        tf_transforms = std::make_shared<std::vector<tf::StampedTransform>>(seq.transforms);
-
-        /// init map provider ...
-        ROS_INFO_STREAM("Setting tf!");
-        for(auto map : map_providers_){
-            if(!map.second->initializeTF(*tf_transforms) && count == 0){ // actually tf transforms are only required in the first iteration
-                ROS_ERROR_STREAM("Couldn't set initial tf transfroms!"); // to jump to correct links when the motion model is applied before.
-                return;                                                  // the first update is applied. The update model actually calulats FK
-            }                                                            // and updates the map transforms.
+        n_samples += seq.data.size();
+        cslibs_time::Time current_time = cslibs_time::Time::now();
+        ROS_INFO_STREAM("processed: " << ++count << " of " << nv << " messages.");
+        of << "Send sequences: " << count << " of " << nv << std::endl;
+        const std::size_t total = data_file_ ? data_file_->numSamples() : (data_stream_ ? data_stream_->samplesRead() : data_set_->n_samples);
+        of << "Send samples:   " << n_samples << " of " << total << std::endl;
+        of << "duration:       " << (current_time - start_time).seconds() << " seconds." << std::endl;
+        of.close();
+    };
+
+    if (data_file_) {
+        ContactEvaluationSample seq;
+        uint64_t bag_time;
+        for (std::size_t i = 0 ; i < data_file_->size() ; ++i) {
+            if (!data_file_->read(i, seq, bag_time)) {
+                ROS_ERROR_STREAM("Data file is corrupted at sequence " << i << "!");
+                return;
+            }
+            if (seq.data.size() == 0) {
+                ROS_ERROR_STREAM("Cannot work with an empty sequence!");
+                continue;
+            }
+            if (!processSequence(seq, count))
+                return;
+            report(seq);
         }
-
-        /// seq data
-        if(seq.data.size() == 0) {
-            ROS_ERROR_STREAM("Cannot work with an empty sequence!");
-            continue;
+    } else if (data_stream_) {
+        ContactEvaluationSample seq;
+        while (data_stream_->next(seq)) {
+            if (seq.data.size() == 0) {
+                ROS_ERROR_STREAM("Cannot work with an empty sequence!");
+                continue;
+            }
+            if (!processSequence(seq, count))
+                return;
+            report(seq);
         }
+    } else {
+        for(ContactEvaluationSample& seq : *data_set_){
+            if(seq.data.size() == 0) {
+                ROS_ERROR_STREAM("Cannot work with an empty sequence!");
+                continue;
+            }
+            if (!processSequence(seq, count))
+                return;
+            report(seq);
+        }
+    }
+    ROS_INFO_STREAM("Fillter processed " << n_samples << " samples!");
+}
+
+bool MuseARMCLOfflineNode::processSequence(ContactEvaluationSample &seq, const std::size_t count)
+{
+    /// init map provider ...
+    ROS_INFO_STREAM("Setting tf!");
+    for(auto map : map_providers_){
+        if(!map.second->initializeTF(seq.transforms) && count == 0){ // actually tf transforms are only required in the first iteration
+            ROS_ERROR_STREAM("Couldn't set initial tf transfroms!"); // to jump to correct links when the motion model is applied before.
+            return false;                                            // the first update is applied. The update model actually calulats FK
+        }                                                            // and updates the map transforms.
+    }
 
-        state_publisher_->setData(seq.data);
+    state_publisher_->setData(seq.data);
 
-        if (!particle_filter_->start()) {
-            ROS_ERROR_STREAM("Couldn't start the filter!");
-            return;
-        }
+    if (!particle_filter_->start()) {
+        ROS_ERROR_STREAM("Couldn't start the filter!");
+        return false;
+    }
 
-        particle_filter_->requestUniformInitialization(time_t(seq.data.getMinTime()));
-
-        /// itearte the sequence to test and tick the tf broadcaster
-        std::size_t index = 0;
-        for(ContactSample &s : seq.data) {
-            for(auto &d : data_providers_) {
-                if(d.second->isType<JointStateProvider>()) {
-                    JointStateProvider &j = d.second->as<JointStateProvider>();
-                    sensor_msgs::JointState::Ptr js(new sensor_msgs::JointState);
-                    cslibs_kdl::JointStateStampedConversion::data2ros(s.state, *js);
-                    /// use time stamp from map here
-                    js->header.stamp.fromNSec(seq.data.getTimeFromIndex(index));
-                    j.callback(js);
-                 }
-            }
-            ++index;
+    particle_filter_->requestUniformInitialization(time_t(seq.data.getMinTime()));
+
+    /// itearte the sequence to test and tick the tf broadcaster
+    std::size_t index = 0;
+    for(ContactSample &s : seq.data) {
+        for(auto &d : data_providers_) {
+            if(d.second->isType<JointStateProvider>()) {
+                JointStateProvider &j = d.second->as<JointStateProvider>();
+                sensor_msgs::JointState::Ptr js(new sensor_msgs::JointState);
+                cslibs_kdl::JointStateStampedConversion::data2ros(s.state, *js);
+                /// use time stamp from map here
+                js->header.stamp.fromNSec(seq.data.getTimeFromIndex(index));
+                j.callback(js);
+             }
         }
-        n_samples += seq.data.size();
-        ROS_INFO_STREAM("Send " << seq.data.size() << " messages");
-        ros::Time expected;
-        expected.fromNSec(seq.data.getMaxTime());
-        ros::Time start;
-        start.fromNSec(seq.data.getMinTime());
-        ROS_INFO_STREAM(start << " to " << expected);
-
-        double node_rate = nh_private_.param<double>("node_rate", 60.0);
-        while(ros::ok()) {
-            {
-                std::unique_lock<std::mutex> l(filter_time_mutex_);
-                if(expected == filter_time_) {
-                    ROS_INFO_STREAM("Filter time reached.");
-                    break;
-                }
-            }
-            ros::spinOnce();
-            if(node_rate > 0.0) {
-                ros::WallRate(node_rate).sleep();
+        ++index;
+    }
+    ROS_INFO_STREAM("Send " << seq.data.size() << " messages");
+    ros::Time expected;
+    expected.fromNSec(seq.data.getMaxTime());
+    ros::Time start;
+    start.fromNSec(seq.data.getMinTime());
+    ROS_INFO_STREAM(start << " to " << expected);
+
+    double node_rate = nh_private_.param<double>("node_rate", 60.0);
+    while(ros::ok()) {
+        {
+            std::unique_lock<std::mutex> l(filter_time_mutex_);
+            if(expected == filter_time_) {
+                ROS_INFO_STREAM("Filter time reached.");
+                break;
             }
-            //// tiny workaround
-           particle_filter_->triggerEvent();
         }
-        	
-        state_publisher_->reset();
-        state_publisher_->exportResults(results_file_base_name_);
-        cslibs_time::Time current_time = cslibs_time::Time::now();
-        ROS_INFO_STREAM("processed: " << ++count << " of " << nv << " messages.");
-        of << "Send sequences: " << count << " of " << nv << std::endl;
-        of << "Send samples:   " << n_samples << " of " << data_set_->n_samples << std::endl;
-        of << "duration:       " << (current_time - start_time).seconds() << " seconds." << std::endl;
-        of.close();
-       particle_filter_->end();
+        ros::spinOnce();
+        if(node_rate > 0.0) {
+            ros::WallRate(node_rate).sleep();
+        }
+        //// tiny workaround
+       particle_filter_->triggerEvent();
     }
-    ROS_INFO_STREAM("Fillter processed " << n_samples << " samples!");
+
+    state_publisher_->reset();
+    state_publisher_->exportResults(results_file_base_name_);
+    particle_filter_->end();
+    return true;
 }
 
 bool MuseARMCLOfflineNode::getPredictionDataProvider(data_provider_t::Ptr &prediction_provider)
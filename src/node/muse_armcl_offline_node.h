@@ -7,6 +7,8 @@
 
 #include <muse_armcl/state_space/mesh_map_provider.hpp>
 #include <muse_armcl/evaluation/contact_evaluation_data.hpp>
+#include <muse_armcl/evaluation/data_set_stream.hpp>
+#include <muse_armcl/evaluation/binary_data_set.hpp>
 #include <muse_armcl/prediction/prediction_model.hpp>
 #include <muse_armcl/update/update_model.hpp>
 
@@ -99,6 +101,8 @@ private:
     /// rosbag
 //    std::shared_ptr<rosbag::Bag>  bag_;
     std::shared_ptr<DataSet>      data_set_;
+    DataSetStream::Ptr            data_stream_;   /// used instead of data_set_ if stream_data is set
+    BinaryDataSet::Ptr            data_file_;     /// used instead of the bag if data_file is set
     std::string                   bag_joint_state_topic_;
     std::string                   bag_tf_topic_;
     /// results
@@ -108,6 +112,7 @@ private:
     bool getUpdateModelProviderMapping(update_model_mapping_t &update_mapping);
 
     void setFilterTime(const cslibs_time::Time &t);
+    bool processSequence(ContactEvaluationSample &seq, const std::size_t count);
 
 };
 }
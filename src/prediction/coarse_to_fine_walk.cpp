@@ -0,0 +1,270 @@
+#include <muse_armcl/prediction/prediction_model.hpp>
+#include <muse_armcl/state_space/mesh_map.hpp>
+#include <muse_armcl/common/clock.hpp>
+
+#include <cslibs_math/random/random.hpp>
+
+namespace muse_armcl {
+/**
+ * @brief Random walk on the decimated levels of the compiled mesh map. While
+ *        the particles are spread out, e.g. right after contact onset, they
+ *        only live on the cluster representatives of the coarsest level. As
+ *        the weighted spread in base coordinates shrinks below a multiple of
+ *        the cell size of the next finer level, the particles are scattered
+ *        onto the children of their cluster, down to the full resolution mesh.
+ *        Only the resolution of the particle positions depends on the level,
+ *        the number of particles is left to the sample set of muse_smc.
+ */
+class EIGEN_ALIGN16 CoarseToFineWalk : public PredictionModel
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t   = Eigen::aligned_allocator<CoarseToFineWalk>;
+    using data_t        = cslibs_plugins_data::Data;
+    using time_t        = cslibs_time::Time;
+    using duration_t    = cslibs_time::Duration;
+    using rng_t         = cslibs_math::random::Uniform<double,1>;
+    using normal_rng_t  = cslibs_math::random::Normal<double,1>;
+    using index_t       = CompiledMeshMap::index_t;
+    using level_t       = CompiledMeshMap::Level;
+    using vertex_t      = cslibs_mesh_map::MeshMap::VertexHandle;
+
+    virtual void setup(ros::NodeHandle &nh) override
+    {
+        auto param_name = [this](const std::string &name){return name_ + "/" + name;};
+        random_seed_      = nh.param(param_name("seed"), -1);
+        refine_factor_    = nh.param(param_name("refine_factor"), 4.0);
+        move_probability_ = nh.param(param_name("move_probability"), 0.5);
+        jump_probability_ = nh.param(param_name("jump_probability"), 0.1);
+        fine_step_        = nh.param(param_name("fine_step"), 0.02);
+        max_steps_        = static_cast<std::size_t>(std::max(1, nh.param(param_name("max_steps"), 64)));
+
+        double rate = nh.param<double>(param_name("rate"), 15.0);
+        walk_period_ = duration_t(rate > 0.0 ? 1.0 / rate : 0.0);
+        clock_.setup(nh);
+
+        uniform_.reset(random_seed_ >= 0 ? new rng_t(0.0, 1.0, random_seed_) : new rng_t(0.0, 1.0));
+        normal_.reset(random_seed_ >= 0 ? new normal_rng_t(0.0, 1.0, random_seed_ + 1) : new normal_rng_t(0.0, 1.0));
+    }
+
+    virtual Result::Ptr apply(const data_t::ConstPtr         &data,
+                              const cslibs_time::Time        &until,
+                              sample_set_t::state_iterator_t  states) override
+    {
+        std::cerr << "[PredictionModel]: Model called without map!" << std::endl;
+        return Result::Ptr(new Result(data));
+    }
+
+    virtual Result::Ptr apply(const data_t::ConstPtr                 &data,
+                              const typename state_space_t::ConstPtr &state_space,
+                              const cslibs_time::Time                &until,
+                              sample_set_t::state_iterator_t          states) override
+    {
+        if (!state_space->isType<MeshMap>())
+            return false;
+
+        const time_t time_now = clock_.now(until);
+        if (walk_time_.isZero())
+            walk_time_ = time_now;
+        if (time_now < walk_time_)
+            return Result::Ptr(new Result(data));
+        walk_time_ = time_now + walk_period_;
+
+        /// jump targets and the spread follow the latest snapshot, there are no jumps before the first update
+        const MeshMap &mesh_map = state_space->as<MeshMap>();
+        const KinematicSnapshot::ConstPtr kinematics = mesh_map.snapshot();
+        const CompiledMeshMapTree::ConstPtr compiled = mesh_map.compiled(kinematics);
+        if (!compiled) {
+            std::cerr << "[CoarseToFineWalk]: Map is not compiled, cannot walk!" << std::endl;
+            return Result::Ptr(new Result(data));
+        }
+
+        samples_.clear();
+        for (sample_t &sample : states)
+            samples_.emplace_back(&sample);
+
+        /// level 0 is the full resolution mesh, level l > 0 is the decimated level l - 1
+        const std::size_t levels = compiled->numLevels();
+        const std::size_t target = kinematics ? targetLevel(*compiled, *kinematics, levels) : levels;
+        if (target == levels || level_ > levels) {
+            /// contact onset or a reset, start over on the coarsest level
+            level_ = levels;
+        } else if (target < level_) {
+            /// refine one level per step
+            for (sample_t *sample : samples_)
+                refine(*compiled, sample->state);
+            --level_;
+        }
+
+        for (sample_t *sample : samples_) {
+            if (level_ == 0)
+                walkFine(*compiled, sample->state);
+            else
+                walkCoarse(*compiled, sample->state);
+        }
+
+        return Result::Ptr(new Result(data));
+    }
+
+private:
+    int                         random_seed_;
+    double                      refine_factor_;
+    double                      move_probability_;
+    double                      jump_probability_;
+    double                      fine_step_;
+    std::size_t                 max_steps_;
+    duration_t                  walk_period_;
+    time_t                      walk_time_;
+    Clock                       clock_;
+    std::size_t                 level_ = std::numeric_limits<std::size_t>::max();
+
+    rng_t::Ptr                  uniform_;
+    normal_rng_t::Ptr           normal_;
+    std::vector<sample_t*>      samples_;
+
+    /// finest level whose cells are still small compared to the weighted particle spread
+    inline std::size_t targetLevel(const CompiledMeshMapTree &compiled,
+                                   const KinematicSnapshot   &kinematics,
+                                   const std::size_t          levels) const
+    {
+        cslibs_math_3d::Vector3d sum(0.0, 0.0, 0.0);
+        double sum_sq = 0.0;
+        double weight = 0.0;
+        for (const sample_t *sample : samples_) {
+            const state_t &state = sample->state;
+            const CompiledMeshMap *c = compiled.get(state.map_id);
+            if (!c || !kinematics.node(state.map_id))
+                continue;
+            const double w = state.last_update;
+            const cslibs_math_3d::Vector3d p = kinematics.baseTLink(state.map_id) * c->position(state);
+            sum    = sum + p * w;
+            sum_sq += w * p.dot(p);
+            weight += w;
+        }
+        if (weight <= 0.0)
+            return levels;
+
+        const cslibs_math_3d::Vector3d mean = sum * (1.0 / weight);
+        const double spread = std::sqrt(std::max(0.0, sum_sq / weight - mean.dot(mean)));
+
+        /// all links are decimated with the same cell sizes
+        const CompiledMeshMap *c = nullptr;
+        for (std::size_t m = 0 ; !c && m < compiled.size() ; ++m)
+            c = compiled.get(m);
+        std::size_t level = 0;
+        while (c && level < levels && spread > refine_factor_ * c->levels[level].cell_size)
+            ++level;
+        return level;
+    }
+
+    inline index_t vertex(const state_t &state) const
+    {
+        return static_cast<index_t>(state.s < 0.5 ? state.active_vertex.idx() : state.goal_vertex.idx());
+    }
+
+    /// scatter a particle onto a random child of its cluster on the next finer level
+    inline void refine(const CompiledMeshMapTree &compiled, state_t &state)
+    {
+        const CompiledMeshMap *c = compiled.get(state.map_id);
+        if (!c || level_ == 0 || level_ > c->levels.size())
+            return;
+        const level_t &l = c->levels[level_ - 1];
+        const index_t k = l.cluster[vertex(state)];
+        const std::size_t n = l.children_offsets[k + 1] - l.children_offsets[k];
+        if (n == 0)
+            return;
+        const index_t child = l.children[l.children_offsets[k] + pick(n)];
+        const index_t v = level_ == 1 ? child : c->levels[level_ - 2].vertices[child];
+        set(state, state.map_id, v, v, 0.0);
+    }
+
+    /// hop between cluster representatives of the current level
+    inline void walkCoarse(const CompiledMeshMapTree &compiled, state_t &state)
+    {
+        const CompiledMeshMap *c = compiled.get(state.map_id);
+        if (!c || level_ > c->levels.size())
+            return;
+        std::size_t map_id = state.map_id;
+        const level_t *l = &c->levels[level_ - 1];
+        index_t k = l->cluster[vertex(state)];
+
+        /// switch links through a boundary vertex of the cluster
+        const std::size_t n_boundary = l->boundary_offsets[k + 1] - l->boundary_offsets[k];
+        if (n_boundary > 0 && uniform_->get() < jump_probability_) {
+            const index_t b = l->boundary[l->boundary_offsets[k] + pick(n_boundary)];
+            const std::size_t n_jumps = compiled.jumpsEnd(map_id, b) - compiled.jumpsBegin(map_id, b);
+            if (n_jumps > 0) {
+                const CompiledMeshMapTree::JumpTarget &j = compiled.jumpsBegin(map_id, b)[pick(n_jumps)];
+                const CompiledMeshMap *o = compiled.get(j.map_id);
+                if (o && o->levels.size() >= level_) {
+                    map_id = j.map_id;
+                    c      = o;
+                    l      = &c->levels[level_ - 1];
+                    k      = l->cluster[j.vertex];
+                }
+            }
+        } else if (uniform_->get() < move_probability_) {
+            const std::size_t degree = l->adjacency_offsets[k + 1] - l->adjacency_offsets[k];
+            if (degree > 0)
+                k = l->adjacency[l->adjacency_offsets[k] + pick(degree)];
+        }
+
+        const index_t v = l->vertices[k];
+        set(state, map_id, v, v, 0.0);
+    }
+
+    /// normally distributed walking distance along random edges of the full resolution mesh
+    inline void walkFine(const CompiledMeshMapTree &compiled, state_t &state)
+    {
+        const CompiledMeshMap *c = compiled.get(state.map_id);
+        if (!c)
+            return;
+
+        double budget = std::fabs(normal_->get()) * fine_step_;
+        std::size_t map_id = state.map_id;
+        index_t     v      = vertex(state);
+        for (std::size_t step = 0 ; step < max_steps_ ; ++step) {
+            const std::size_t n_jumps = compiled.jumpsEnd(map_id, v) - compiled.jumpsBegin(map_id, v);
+            if (n_jumps > 0 && uniform_->get() < jump_probability_) {
+                const CompiledMeshMapTree::JumpTarget &j = compiled.jumpsBegin(map_id, v)[pick(n_jumps)];
+                if (compiled.get(j.map_id)) {
+                    map_id = j.map_id;
+                    v      = j.vertex;
+                    c      = compiled.get(map_id);
+                }
+            }
+            if (c->degree(v) == 0)
+                break;
+
+            const index_t next   = c->neighboursBegin(v)[pick(c->degree(v))];
+            const double  length = (c->point(next) - c->point(v)).length();
+            if (budget < length || step + 1 == max_steps_) {
+                set(state, map_id, v, next, length > 0.0 ? std::min(1.0, budget / length) : 0.0);
+                return;
+            }
+            budget -= length;
+            v = next;
+        }
+
+        /// isolated vertex, stay on it
+        set(state, map_id, v, v, 0.0);
+    }
+
+    /// uniform index in [0, n)
+    inline std::size_t pick(const std::size_t n)
+    {
+        return std::min(n - 1, static_cast<std::size_t>(uniform_->get() * static_cast<double>(n)));
+    }
+
+    inline void set(state_t &state, const std::size_t map_id, const index_t active, const index_t goal, const double s) const
+    {
+        state.map_id        = map_id;
+        state.active_vertex = vertex_t(static_cast<int>(active));
+        state.goal_vertex   = vertex_t(static_cast<int>(goal));
+        state.s             = s;
+    }
+};
+}
+
+#include <class_loader/class_loader_register_macro.h>
+CLASS_LOADER_REGISTER_CLASS(muse_armcl::CoarseToFineWalk, muse_armcl::PredictionModel)
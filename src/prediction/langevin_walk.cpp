@@ -0,0 +1,343 @@
+#include <muse_armcl/prediction/prediction_model.hpp>
+#include <muse_armcl/state_space/mesh_map.hpp>
+#include <muse_armcl/update/joint_state_data.hpp>
+#include <muse_armcl/common/clock.hpp>
+
+#include <cslibs_kdl/external_forces.h>
+#include <cslibs_kdl/kdl_conversion.h>
+#include <cslibs_math/random/random.hpp>
+
+namespace muse_armcl {
+/**
+ * @brief Likelihood guided walk on the compiled mesh graph. The torque
+ *        residual r(v) = |tau_s - tau(v)|^2 between the normalized sensed
+ *        external torques and the normalized torques J(v)^T F(v) of a contact
+ *        at vertex v is computed from the Jacobians of the latest kinematic
+ *        snapshot, lazily for the vertices the particles visit.
+ *        Particles walk a normally distributed distance, every step picks a
+ *        neighbour with probability proportional to exp(-beta / 2 (r(n) - r(v))),
+ *        which drifts them down the residual while still exploring. Without a
+ *        snapshot or torques the walk is uniform.
+ *        The walking distance is scaled by the particle spread per link.
+ */
+class EIGEN_ALIGN16 LangevinWalk : public PredictionModel
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t   = Eigen::aligned_allocator<LangevinWalk>;
+    using data_t        = cslibs_plugins_data::Data;
+    using time_t        = cslibs_time::Time;
+    using duration_t    = cslibs_time::Duration;
+    using rng_t         = cslibs_math::random::Uniform<double,1>;
+    using normal_rng_t  = cslibs_math::random::Normal<double,1>;
+    using index_t       = CompiledMeshMap::index_t;
+    using vertex_t      = cslibs_mesh_map::MeshMap::VertexHandle;
+
+    virtual void setup(ros::NodeHandle &nh) override
+    {
+        auto param_name = [this](const std::string &name){return name_ + "/" + name;};
+        random_seed_      = nh.param(param_name("seed"), -1);
+        min_step_         = nh.param(param_name("min_step"), 0.005);
+        max_step_         = nh.param(param_name("max_step"), 0.1);
+        spread_gain_      = nh.param(param_name("spread_gain"), 0.5);
+        beta_             = nh.param(param_name("beta"), 1.0);
+        jump_probability_ = nh.param(param_name("jump_probability"), 0.1);
+        max_steps_        = static_cast<std::size_t>(std::max(1, nh.param(param_name("max_steps"), 64)));
+
+        if (min_step_ > max_step_)
+            throw std::runtime_error("[LangevinWalk]: min_step has to be smaller than max_step!");
+
+        double rate = nh.param<double>(param_name("rate"), 15.0);
+        walk_period_ = duration_t(rate > 0.0 ? 1.0 / rate : 0.0);
+        clock_.setup(nh);
+
+        uniform_.reset(random_seed_ >= 0 ? new rng_t(0.0, 1.0, random_seed_) : new rng_t(0.0, 1.0));
+        normal_.reset(random_seed_ >= 0 ? new normal_rng_t(0.0, 1.0, random_seed_ + 1) : new normal_rng_t(0.0, 1.0));
+    }
+
+    virtual Result::Ptr apply(const data_t::ConstPtr         &data,
+                              const cslibs_time::Time        &until,
+                              sample_set_t::state_iterator_t  states) override
+    {
+        std::cerr << "[PredictionModel]: Model called without map!" << std::endl;
+        return Result::Ptr(new Result(data));
+    }
+
+    virtual Result::Ptr apply(const data_t::ConstPtr                 &data,
+                              const typename state_space_t::ConstPtr &state_space,
+                              const cslibs_time::Time                &until,
+                              sample_set_t::state_iterator_t          states) override
+    {
+        if (!state_space->isType<MeshMap>())
+            return false;
+
+        const time_t time_now = clock_.now(until);
+        if (walk_time_.isZero())
+            walk_time_ = time_now;
+        if (time_now < walk_time_)
+            return Result::Ptr(new Result(data));
+        walk_time_ = time_now + walk_period_;
+
+        /// jump targets and Jacobians follow the latest snapshot, there are no jumps before the first update
+        const MeshMap &mesh_map = state_space->as<MeshMap>();
+        kinematics_ = mesh_map.snapshot();
+        const CompiledMeshMapTree::ConstPtr compiled = mesh_map.compiled(kinematics_);
+        if (!compiled) {
+            std::cerr << "[LangevinWalk]: Map is not compiled, cannot walk!" << std::endl;
+            return Result::Ptr(new Result(data));
+        }
+
+        samples_.clear();
+        for (sample_t &sample : states)
+            samples_.emplace_back(&sample);
+
+        updateField(*compiled, data);
+        for (sample_t *sample : samples_)
+            walk(*compiled, sample->state);
+
+        kinematics_.reset();
+        return Result::Ptr(new Result(data));
+    }
+
+private:
+    /// torque residual per vertex, negative until computed, and particle spread of one link
+    struct Field
+    {
+        std::vector<double>  residual;
+        std::vector<index_t> touched;
+        bool                 guided = false;
+        bool                 finger = false;
+        cslibs_math_3d::Vector3d sum;
+        double               sum_sq = 0.0;
+        std::size_t          count  = 0;
+        double               step   = 0.0;
+    };
+
+    int                         random_seed_;
+    double                      min_step_;
+    double                      max_step_;
+    double                      spread_gain_;
+    double                      beta_;
+    double                      jump_probability_;
+    std::size_t                 max_steps_;
+    duration_t                  walk_period_;
+    time_t                      walk_time_;
+    Clock                       clock_;
+
+    rng_t::Ptr                  uniform_;
+    normal_rng_t::Ptr           normal_;
+    std::vector<Field>          fields_;
+    std::vector<sample_t*>      samples_;
+    std::vector<double>         weights_;
+
+    KinematicSnapshot::ConstPtr kinematics_;
+    Eigen::VectorXd             tau_sensed_;
+    Eigen::VectorXd             tau_;
+
+    inline void updateField(const CompiledMeshMapTree &compiled, const data_t::ConstPtr &data)
+    {
+        if (fields_.size() < compiled.size())
+            fields_.resize(compiled.size());
+
+        /// the sensed torques are aligned to the longest chain like in the update model
+        const bool kinematic = kinematics_ && kinematics_->hasJacobians() && data && data->isType<JointStateData>();
+        std::size_t n_joints = 0;
+        if (kinematic) {
+            for (std::size_t m = 0 ; m < kinematics_->size() ; ++m) {
+                if (kinematics_->node(m))
+                    n_joints = std::max(n_joints, static_cast<std::size_t>(kinematics_->jacobian(m).rows()));
+            }
+        }
+        bool guided = false;
+        if (n_joints > 0) {
+            const std::vector<double> &effort = data->as<JointStateData>().effort;
+            if (effort.size() >= n_joints) {
+                cslibs_kdl::convert(effort, tau_sensed_, effort.size() - n_joints);
+                const double norm = tau_sensed_.norm();
+                guided = norm > 1e-5;
+                if (guided)
+                    tau_sensed_ /= norm;
+                tau_.resize(static_cast<Eigen::Index>(n_joints));
+            }
+        }
+
+        for (std::size_t m = 0 ; m < fields_.size() ; ++m) {
+            Field &f = fields_[m];
+            const CompiledMeshMap *c = compiled.get(m);
+            const std::size_t n = c ? c->numVertices() : 0;
+            if (f.residual.size() != n) {
+                f.residual.assign(n, -1.0);
+            } else {
+                for (const index_t v : f.touched)
+                    f.residual[v] = -1.0;
+            }
+            f.touched.clear();
+            const cslibs_mesh_map::MeshMapTreeNode *node = guided ? kinematics_->node(m) : nullptr;
+            f.guided = node && kinematics_->jacobian(m).cols() == 6 && kinematics_->jacobian(m).rows() > 0;
+            f.finger = node && node->map.frame_id_.find("finger") != std::string::npos;
+            f.sum    = cslibs_math_3d::Vector3d(0.0, 0.0, 0.0);
+            f.sum_sq = 0.0;
+            f.count  = 0;
+        }
+
+        for (const sample_t *sample : samples_) {
+            const state_t &state = sample->state;
+            const CompiledMeshMap *c = compiled.get(state.map_id);
+            if (!c)
+                continue;
+            Field &f = fields_[state.map_id];
+            const cslibs_math_3d::Vector3d p = c->position(state);
+            f.sum    = f.sum + p;
+            f.sum_sq += p.dot(p);
+            ++f.count;
+        }
+
+        /// rms distance to the mean sets the step size, a wide spread explores further
+        for (Field &f : fields_) {
+            double spread = max_step_;
+            if (f.count > 1) {
+                const double n = static_cast<double>(f.count);
+                const cslibs_math_3d::Vector3d mean = f.sum * (1.0 / n);
+                spread = std::sqrt(std::max(0.0, f.sum_sq / n - mean.dot(mean)));
+            }
+            f.step = std::min(max_step_, std::max(min_step_, spread_gain_ * spread));
+        }
+    }
+
+    /// residual of a contact at vertex v, zero on links without Jacobians
+    inline double residual(const CompiledMeshMapTree &compiled, const std::size_t map_id, const index_t v)
+    {
+        Field &f = fields_[map_id];
+        if (!f.guided || v >= f.residual.size())
+            return 0.0;
+        double &r = f.residual[v];
+        if (r >= 0.0)
+            return r;
+
+        /// same wrench and torque projection as the normalized update model
+        const CompiledMeshMap *c = compiled.get(map_id);
+        const cslibs_math_3d::Vector3d p = c->point(v);
+        const cslibs_math_3d::Vector3d n = c->normal(v);
+        KDL::Wrench w = cslibs_kdl::ExternalForcesSerialChain::createWrench(KDL::Vector(p(0), p(1), p(2)),
+                                                                            KDL::Vector(n(0), n(1), n(2)));
+        if (f.finger)
+            w = kinematics_->linkFrame(map_id) * w;
+        const Eigen::VectorXd tau_local = kinematics_->jacobian(map_id) * cslibs_kdl::convert2Eigen(w);
+
+        tau_.setZero();
+        const Eigen::Index rows = std::min(tau_local.rows(), tau_.rows());
+        tau_.head(rows) = tau_local.head(rows);
+        const double norm = tau_.norm();
+        if (norm > 1e-5)
+            tau_ /= norm;
+
+        r = (tau_sensed_ - tau_).squaredNorm();
+        f.touched.emplace_back(v);
+        return r;
+    }
+
+    /// locally balanced weight of moving from residual r_from to r_to
+    inline double balance(const double r_from, const double r_to) const
+    {
+        return std::exp(-0.5 * beta_ * (r_to - r_from));
+    }
+
+    inline void walk(const CompiledMeshMapTree &compiled, state_t &state)
+    {
+        const CompiledMeshMap *c = compiled.get(state.map_id);
+        if (!c)
+            return;
+
+        double budget = std::fabs(normal_->get()) * fields_[state.map_id].step;
+
+        /// leave the current edge towards one of its end points
+        index_t a = static_cast<index_t>(state.active_vertex.idx());
+        index_t g = static_cast<index_t>(state.goal_vertex.idx());
+        double  s = state.s;
+        if (a != g) {
+            const double r_a = residual(compiled, state.map_id, a);
+            const double r_g = residual(compiled, state.map_id, g);
+            const double w_g = balance(r_a, r_g);
+            const double w_a = balance(r_g, r_a);
+            if (uniform_->get() * (w_a + w_g) >= w_g) {
+                std::swap(a, g);
+                s = 1.0 - s;
+            }
+            const double length = (c->point(g) - c->point(a)).length();
+            const double rest   = (1.0 - s) * length;
+            if (budget < rest) {
+                set(state, state.map_id, a, g, length > 0.0 ? s + budget / length : s);
+                return;
+            }
+            budget -= rest;
+        }
+
+        std::size_t map_id = state.map_id;
+        index_t     v      = g;
+        for (std::size_t step = 0 ; step < max_steps_ ; ++step) {
+            /// switch links through a boundary vertex
+            if (compiled.jumpsBegin(map_id, v) != compiled.jumpsEnd(map_id, v) && uniform_->get() < jump_probability_) {
+                const CompiledMeshMapTree::JumpTarget &j = pickJump(compiled, map_id, v);
+                if (compiled.get(j.map_id)) {
+                    map_id = j.map_id;
+                    v      = j.vertex;
+                    c      = compiled.get(map_id);
+                }
+            }
+            if (c->degree(v) == 0)
+                break;
+
+            const index_t next   = pickNeighbour(compiled, *c, map_id, v);
+            const double  length = (c->point(next) - c->point(v)).length();
+            if (budget < length || step + 1 == max_steps_) {
+                set(state, map_id, v, next, length > 0.0 ? std::min(1.0, budget / length) : 0.0);
+                return;
+            }
+            budget -= length;
+            v = next;
+        }
+
+        /// isolated vertex, stay on it
+        set(state, map_id, v, v, 0.0);
+    }
+
+    inline index_t pickNeighbour(const CompiledMeshMapTree &compiled, const CompiledMeshMap &c,
+                                 const std::size_t map_id, const index_t v)
+    {
+        const double r_v = residual(compiled, map_id, v);
+        weights_.clear();
+        double sum = 0.0;
+        for (const index_t *n = c.neighboursBegin(v) ; n != c.neighboursEnd(v) ; ++n) {
+            sum += balance(r_v, residual(compiled, map_id, *n));
+            weights_.emplace_back(sum);
+        }
+        const double r = uniform_->get() * sum;
+        const std::size_t i = static_cast<std::size_t>(std::upper_bound(weights_.begin(), weights_.end(), r) - weights_.begin());
+        return c.neighboursBegin(v)[std::min(i, weights_.size() - 1)];
+    }
+
+    inline const CompiledMeshMapTree::JumpTarget& pickJump(const CompiledMeshMapTree &compiled, const std::size_t map_id, const index_t v)
+    {
+        weights_.clear();
+        double sum = 0.0;
+        for (const CompiledMeshMapTree::JumpTarget *j = compiled.jumpsBegin(map_id, v) ; j != compiled.jumpsEnd(map_id, v) ; ++j) {
+            sum += j->map_id < fields_.size() ? std::exp(-0.5 * beta_ * residual(compiled, j->map_id, j->vertex)) : 1.0;
+            weights_.emplace_back(sum);
+        }
+        const double r = uniform_->get() * sum;
+        const std::size_t i = static_cast<std::size_t>(std::upper_bound(weights_.begin(), weights_.end(), r) - weights_.begin());
+        return compiled.jumpsBegin(map_id, v)[std::min(i, weights_.size() - 1)];
+    }
+
+    inline void set(state_t &state, const std::size_t map_id, const index_t active, const index_t goal, const double s) const
+    {
+        state.map_id        = map_id;
+        state.active_vertex = vertex_t(static_cast<int>(active));
+        state.goal_vertex   = vertex_t(static_cast<int>(goal));
+        state.s             = s;
+    }
+};
+}
+
+#include <class_loader/class_loader_register_macro.h>
+CLASS_LOADER_REGISTER_CLASS(muse_armcl::LangevinWalk, muse_armcl::PredictionModel)
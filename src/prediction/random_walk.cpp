@@ -1,7 +1,9 @@
 #include <muse_armcl/prediction/prediction_model.hpp>
 #include <muse_armcl/state_space/mesh_map.hpp>
+#include <muse_armcl/state_space/compiled_random_walk.hpp>
+#include <muse_armcl/common/thread_pool.hpp>
+#include <muse_armcl/common/clock.hpp>
 
-#include <cslibs_mesh_map/random_walk.hpp>
 #include <cslibs_math/random/random.hpp>
 
 namespace muse_armcl {
@@ -23,8 +25,14 @@ public:
         max_distance_     = nh.param(param_name("max_distance"), 0.1);
         jump_probability_ = nh.param(param_name("jump_probability"), 0.3);
 
+        /// the partitioning only depends on the chunk count, not on the number of threads
+        const int threads = nh.param(param_name("threads"), 0);
+        n_chunks_         = static_cast<std::size_t>(std::max(1, nh.param(param_name("chunks"), 16)));
+        pool_.reset(new ThreadPool(static_cast<std::size_t>(std::max(0, threads))));
+
         double rate = nh.param<double>(param_name("rate"), 15.0);
         random_walk_period_ = duration_t(rate > 0.0 ? 1.0 / rate : 0.0);
+        clock_.setup(nh);
     }
 
     virtual Result::Ptr apply(const data_t::ConstPtr         &data,
@@ -43,28 +51,48 @@ public:
         if (!state_space->isType<MeshMap>())
             return false;
 
-        const time_t time_now(ros::Time::now().toNSec());
+        const time_t time_now = clock_.now(until);
         if (random_walk_time_.isZero())
             random_walk_time_ = time_now;
 
         if (random_walk_time_ <= time_now) {
             random_walk_time_ = time_now + random_walk_period_;
 
-            using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
-            const mesh_map_tree_t* map = state_space->as<MeshMap>().data();
+            /// jump targets follow the latest snapshot, there are no jumps before the first update
+            const MeshMap &mesh_map = state_space->as<MeshMap>();
+            const CompiledMeshMapTree::ConstPtr compiled = mesh_map.compiled(mesh_map.snapshot());
+            if (!compiled) {
+                std::cerr << "[RandomWalk]: Map is not compiled, cannot walk!" << std::endl;
+                return Result::Ptr(new Result(data));
+            }
+
+            if (chunks_.empty()) {
+                chunks_.resize(n_chunks_);
+                for (std::size_t i = 0 ; i < n_chunks_ ; ++i) {
+                    chunks_[i].rng.reset(random_seed_ >= 0 ?
+                                             new rng_t(0.0, 1.0, random_seed_ + static_cast<int>(i)) :
+                                             new rng_t(0.0, 1.0));
+                }
+            }
 
-            if (!rng_) {
-                rng_.reset(random_seed_ >= 0 ?
-                               new rng_t(min_distance_, max_distance_, random_seed_) :
-                               new rng_t(min_distance_, max_distance_));
-            } else
-                rng_->set(min_distance_, max_distance_);
+            samples_.clear();
+            for (sample_t &sample : states)
+                samples_.emplace_back(&sample);
 
             /// execute random walk for all particles
             /// use random step width between given min_distance and max_distance
-            random_walk_.jump_probability_ = jump_probability_;
-            for (sample_t &sample : states)
-                random_walk_.update(sample, *map, rng_->get());
+            /// every chunk owns its random stream for distances, neighbours and jumps,
+            /// so the result does not depend on the scheduling
+            const std::size_t n = samples_.size();
+            random_walk_.jump_probability = jump_probability_;
+            pool_->run(n_chunks_, [this, n, &compiled](const std::size_t c) {
+                rng_t &rng = *chunks_[c].rng;
+                const std::size_t end = (c + 1) * n / n_chunks_;
+                for (std::size_t i = c * n / n_chunks_ ; i < end ; ++i) {
+                    const double distance = min_distance_ + rng.get() * (max_distance_ - min_distance_);
+                    random_walk_.update(samples_[i]->state, *compiled, distance, rng);
+                }
+            });
         }
 
         return Result::Ptr(new Result(data));
@@ -77,9 +105,19 @@ private:
     double                      jump_probability_;
     duration_t                  random_walk_period_;
     time_t                      random_walk_time_;
+    Clock                       clock_;
+
+    /// state of one fixed partition of the sample set
+    struct Chunk
+    {
+        rng_t::Ptr                  rng;
+    };
 
-    rng_t::Ptr                  rng_;
-    cslibs_mesh_map::RandomWalk random_walk_;
+    CompiledRandomWalk          random_walk_;
+    std::size_t                 n_chunks_;
+    std::vector<Chunk>          chunks_;
+    std::vector<sample_t*>      samples_;
+    ThreadPool::Ptr             pool_;
 };
 }
 
@@ -1,6 +1,6 @@
 #include <muse_armcl/sampling/normal_sampling.hpp>
 
-#include <cslibs_mesh_map/random_walk.hpp>
+#include <muse_armcl/state_space/compiled_random_walk.hpp>
 #include <cslibs_math/sampling/normal.hpp>
 
 namespace muse_armcl {
@@ -23,11 +23,14 @@ public:
         if (!ss->isType<MeshMap>())
             return false;
 
-        using mesh_map_tree_t = cslibs_mesh_map::MeshMapTree;
-        const mesh_map_tree_t* map = ss->as<MeshMap>().data();
+        /// jump targets follow the latest snapshot, there are no jumps before the first update
+        const MeshMap &mesh_map = ss->as<MeshMap>();
+        const CompiledMeshMapTree::ConstPtr compiled = mesh_map.compiled(mesh_map.snapshot());
+        if (!compiled)
+            throw std::runtime_error("[NormalSampling]: Map is not compiled!");
 
         /// set up random generator
-        cslibs_math_3d::Vector3d start = state.getPosition(map->getNode(state.map_id)->map);
+        cslibs_math_3d::Vector3d start = mesh_map.position(state);
         rng_t::Ptr rng(new rng_t(start, covariance));
         if (random_seed_ >= 0)
             rng.reset(new rng_t(start, covariance, random_seed_));
@@ -37,7 +40,9 @@ public:
             throw std::runtime_error("[NormalSampling]: Initialization sample size invalid!");
 
         /// set up random walk
-        random_walk_.jump_probability_ = jump_probability_;
+        random_walk_.jump_probability = jump_probability_;
+        if (!uniform_)
+            uniform_.reset(random_seed_ >= 0 ? new uniform_rng_t(0.0, 1.0, random_seed_ + 1) : new uniform_rng_t(0.0, 1.0));
 
         /// draw samples
         sample_set_t::sample_insertion_t insertion = sample_set.getInsertion();
@@ -53,23 +58,22 @@ public:
             return denominator * std::exp(exp);
         };
 
-        const ros::Time sampling_start = ros::Time::now();
+        const ros::WallTime sampling_start = ros::WallTime::now();
         for (std::size_t i = 0; i < sample_size_; ++i) {
             bool valid = false;
             while (!valid) {
                 /// timeout after too many tries
-                if (sampling_start + sampling_timeout_ < ros::Time::now())
+                if (sampling_start + sampling_timeout_ < ros::WallTime::now())
                     return false;
 
                 /// estimate length
                 cslibs_math_3d::Vector3d end(rng->get());
-                random_walk_.distance_to_travel_ = (end - start).length();
                 const double end_lk = likelihood(end);
 
                 /// do random walk by length
                 state_t p = state;
-                random_walk_.update(p, *map);
-                cslibs_math_3d::Vector3d reached = p.getPosition(map->getNode(p.map_id)->map);
+                random_walk_.update(p, *compiled, (end - start).length(), *uniform_);
+                cslibs_math_3d::Vector3d reached = mesh_map.position(p);
 
                 /// check if reached point has about the same likelihood as target
                 const double reached_lk = likelihood(reached);
@@ -95,7 +99,10 @@ private:
     double                      jump_probability_;
     double                      likelihood_tolerance_;
     MeshMapProvider::Ptr        map_provider_;
-    cslibs_mesh_map::RandomWalk random_walk_;
+    CompiledRandomWalk          random_walk_;
+
+    using uniform_rng_t = CompiledRandomWalk::rng_t;
+    uniform_rng_t::Ptr          uniform_;
 
     using map_provider_map_t = std::map<std::string, MeshMapProvider::Ptr>;
     virtual void doSetup(const map_provider_map_t &map_providers,
@@ -1,4 +1,5 @@
 #include <muse_armcl/scheduling/scheduler.hpp>
+#include <muse_armcl/common/clock.hpp>
 
 #include <unordered_map>
 #include <ext/pb_ds/priority_queue.hpp>
@@ -87,17 +88,19 @@ public:
         double resampling_rate = nh.param<double>(param_name("resampling_rate"), 5.0);
         resampling_period_ = duration_t(resampling_rate > 0.0 ? 1.0 / resampling_rate : 0.0);
         may_resample_ = false;
+        clock_.setup(nh);
     }
 
     virtual bool apply(typename update_t::Ptr     &u,
                        typename sample_set_t::Ptr &s) override
     {
+        /// processing time is always measured in wall time
         auto now = []() {
-            return time_t(ros::Time::now().toNSec());
+            return time_t(ros::WallTime::now().toNSec());
         };
 
-        const time_t time_now = now();
         const time_t stamp    = u->getStamp();
+        const time_t time_now = clock_.now(stamp);
         if (next_update_time_.isZero())
             next_update_time_ = stamp;
 
@@ -111,7 +114,8 @@ public:
             const duration_t dur = (now() - start);
 
             entry.vtime += static_cast<int64_t>(static_cast<double>(dur.nanoseconds()) * nice_values_[id]);
-            next_update_time_ = time_now + dur;
+            /// in data time the processing time does not advance the data time line
+            next_update_time_ = clock_.useDataTime() ? time_now : time_now + dur;
 
             q_.push(entry);
             may_resample_ = true;
@@ -151,6 +155,7 @@ private:
     nice_map_t          nice_values_;
     queue_t             q_;
     bool                may_resample_;
+    Clock               clock_;
 };
 }
 
@@ -0,0 +1,156 @@
+#include <muse_armcl/scheduling/scheduler.hpp>
+#include <muse_armcl/update/joint_state_data.hpp>
+#include <muse_armcl/common/clock.hpp>
+
+namespace muse_armcl {
+/**
+ * @brief Scheduler with an explicit latency budget. Joint states that already
+ *        have a newer joint state of the same provider waiting behind them are
+ *        skipped, so every update uses the freshest torques. Resampling only
+ *        runs if the expected resampling time still fits into the budget left
+ *        by the last update. Deadline misses and the queue depth are reported.
+ */
+class EIGEN_ALIGN16 Deadline : public Scheduler
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    using allocator_t = Eigen::aligned_allocator<Deadline>;
+    using Ptr                 = std::shared_ptr<Deadline>;
+    using update_t            = muse_smc::Update<StateSpaceDescription, cslibs_plugins_data::Data>;
+    using resampling_t        = muse_smc::Resampling<StateSpaceDescription>;
+    using sample_set_t        = muse_smc::SampleSet<StateSpaceDescription>;
+    using time_t              = cslibs_time::Time;
+    using duration_t          = cslibs_time::Duration;
+    using update_model_map_t  = std::map<std::string, UpdateModel::Ptr>;
+
+    inline void setup(const update_model_map_t &update_models,
+                      ros::NodeHandle &nh) override
+    {
+        auto param_name = [this](const std::string &name){return name_ + "/" + name;};
+
+        latency_budget_ = duration_t(nh.param<double>(param_name("latency_budget"), 0.05));
+        coalesce_       = nh.param<bool>(param_name("coalesce"), true);
+        smoothing_      = std::min(1.0, std::max(0.0, nh.param<double>(param_name("smoothing"), 0.1)));
+
+        double resampling_rate = nh.param<double>(param_name("resampling_rate"), 5.0);
+        resampling_period_ = duration_t(resampling_rate > 0.0 ? 1.0 / resampling_rate : 0.0);
+        double report_rate = nh.param<double>(param_name("report_rate"), 1.0);
+        report_period_ = ros::WallDuration(report_rate > 0.0 ? 1.0 / report_rate : 0.0);
+
+        may_resample_ = false;
+        clock_.setup(nh);
+    }
+
+    virtual bool apply(typename update_t::Ptr     &u,
+                       typename sample_set_t::Ptr &s) override
+    {
+        const time_t stamp = u->getStamp();
+        clock_.observe(stamp);
+
+        const cslibs_plugins_data::Data::ConstPtr &data = u->getData();
+        queue_depth_ = data->isType<JointStateData>() ? data->as<JointStateData>().newer() : 0;
+        if (coalesce_ && queue_depth_ > 0) {
+            ++skipped_;
+            report();
+            return false;
+        }
+
+        const ros::WallTime start = ros::WallTime::now();
+        u->apply(s->getWeightIterator());
+        const ros::WallTime end = ros::WallTime::now();
+        update_duration_ = smooth(update_duration_, (end - start).toSec());
+
+        /// in data time only the processing counts, the data is available immediately
+        const double latency = clock_.useDataTime() ?
+                    (end - start).toSec() :
+                    (time_t(ros::Time::now().toNSec()) - stamp).seconds();
+        remaining_budget_ = latency_budget_.seconds() - latency;
+        if (remaining_budget_ < 0.0) {
+            ++misses_;
+            max_miss_ = std::max(max_miss_, -remaining_budget_);
+        }
+        ++processed_;
+
+        may_resample_ = true;
+        report();
+        return true;
+    }
+
+    virtual bool apply(typename resampling_t::Ptr &r,
+                       typename sample_set_t::Ptr &s) override
+    {
+        const time_t &stamp = s->getStamp();
+        if (resampling_time_.isZero())
+            resampling_time_ = stamp;
+
+        /// newer data waits or the resampling would push the update past its deadline
+        if (!may_resample_ || stamp < resampling_time_ || queue_depth_ > 0 ||
+                remaining_budget_ < resampling_duration_) {
+            return false;
+        }
+
+        const ros::WallTime start = ros::WallTime::now();
+        r->apply(*s);
+        const double dur = (ros::WallTime::now() - start).toSec();
+        resampling_duration_ = smooth(resampling_duration_, dur);
+        remaining_budget_ -= dur;
+
+        resampling_time_ = stamp + resampling_period_;
+        may_resample_ = false;
+        return true;
+    }
+
+private:
+    duration_t          latency_budget_;
+    duration_t          resampling_period_;
+    ros::WallDuration   report_period_;
+    bool                coalesce_;
+    double              smoothing_;
+    Clock               clock_;
+
+    time_t              resampling_time_;
+    bool                may_resample_;
+    double              remaining_budget_    = 0.0;
+    double              update_duration_     = 0.0;   /// smoothed, in seconds
+    double              resampling_duration_ = 0.0;   /// smoothed, in seconds
+    uint64_t            queue_depth_         = 0;
+
+    /// counters since the last report
+    std::size_t         processed_ = 0;
+    std::size_t         skipped_   = 0;
+    std::size_t         misses_    = 0;
+    double              max_miss_  = 0.0;
+    ros::WallTime       last_report_;
+
+    inline double smooth(const double mean, const double value) const
+    {
+        return mean == 0.0 ? value : (1.0 - smoothing_) * mean + smoothing_ * value;
+    }
+
+    inline void report()
+    {
+        const ros::WallTime now = ros::WallTime::now();
+        if (last_report_.isZero())
+            last_report_ = now;
+        if (now - last_report_ < report_period_)
+            return;
+
+        if (misses_ > 0)
+            ROS_WARN_STREAM("[" << name_ << "]: " << misses_ << " of " << processed_ << " updates missed the deadline of "
+                            << latency_budget_.seconds() * 1e3 << "ms by up to " << max_miss_ * 1e3 << "ms.");
+        ROS_INFO_STREAM("[" << name_ << "]: processed " << processed_ << ", skipped " << skipped_
+                        << ", queue depth " << queue_depth_
+                        << ", update " << update_duration_ * 1e3 << "ms"
+                        << ", resampling " << resampling_duration_ * 1e3 << "ms.");
+
+        processed_   = 0;
+        skipped_     = 0;
+        misses_      = 0;
+        max_miss_    = 0.0;
+        last_report_ = now;
+    }
+};
+}
+
+#include <class_loader/class_loader_register_macro.h>
+CLASS_LOADER_REGISTER_CLASS(muse_armcl::Deadline, muse_armcl::Scheduler)
@@ -1,4 +1,5 @@
 #include <muse_armcl/scheduling/scheduler.hpp>
+#include <muse_armcl/common/clock.hpp>
 
 namespace muse_armcl {
 class EIGEN_ALIGN16 Dummy : public Scheduler
@@ -18,13 +19,14 @@ public:
                       ros::NodeHandle &nh) override
     {
         may_resample_ = false;
+        clock_.setup(nh);
     }
 
     virtual bool apply(typename update_t::Ptr     &u,
                        typename sample_set_t::Ptr &s) override
     {
         const time_t stamp = u->getStamp();
-        const time_t time_now(ros::Time::now().toNSec());
+        const time_t time_now = clock_.now(stamp);
 
         if (next_update_time_.isZero())
             next_update_time_ = time_now;
@@ -54,6 +56,7 @@ public:
 private:
     time_t next_update_time_;
     bool   may_resample_;
+    Clock  clock_;
 };
 }
 
@@ -1,4 +1,5 @@
 #include <muse_armcl/scheduling/scheduler.hpp>
+#include <muse_armcl/common/clock.hpp>
 
 namespace muse_armcl {
 class EIGEN_ALIGN16 Rate : public Scheduler
@@ -22,13 +23,14 @@ public:
         double resampling_rate = nh.param<double>(param_name("resampling_rate"), 5.0);
         resampling_period_ = duration_t(resampling_rate > 0.0 ? 1.0 / resampling_rate : 0.0);
         may_resample_ = false;
+        clock_.setup(nh);
     }
 
     virtual bool apply(typename update_t::Ptr     &u,
                        typename sample_set_t::Ptr &s) override
     {
         const time_t stamp = u->getStamp();
-        const time_t time_now(ros::Time::now().toNSec());
+        const time_t time_now = clock_.now(stamp);
 
         if (next_update_time_.isZero())
             next_update_time_ = time_now;
@@ -47,7 +49,7 @@ public:
                        typename sample_set_t::Ptr &s) override
     {
         const time_t &stamp = s->getStamp();
-        const time_t time_now(ros::Time::now().toNSec());
+        const time_t time_now = clock_.now(stamp);
 
         if (resampling_time_.isZero())
             resampling_time_ = time_now;
@@ -67,6 +69,7 @@ private:
     time_t              resampling_time_;
     duration_t          resampling_period_;
     bool                may_resample_;
+    Clock               clock_;
 };
 }
 
@@ -0,0 +1,308 @@
+#include <muse_armcl/state_space/compiled_mesh_map.hpp>
+
+#include <ros/console.h>
+#include <ros/time.h>
+
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <sstream>
+
+namespace muse_armcl {
+namespace {
+using mesh_map_t           = cslibs_mesh_map::MeshMap;
+using mesh_map_tree_t      = cslibs_mesh_map::MeshMapTree;
+using mesh_map_tree_node_t = cslibs_mesh_map::MeshMapTreeNode;
+using index_t              = CompiledMeshMap::index_t;
+
+CompiledMeshMap::Ptr compile(const mesh_map_tree_node_t &node)
+{
+    const mesh_map_t &link = node.map;
+    const std::size_t n = link.mesh_.n_vertices();
+
+    CompiledMeshMap::Ptr c(new CompiledMeshMap);
+    c->map_id   = node.mapId();
+    c->frame_id = node.frameId();
+    for (auto *v : {&c->x, &c->y, &c->z, &c->nx, &c->ny, &c->nz})
+        v->resize(n);
+    c->boundary.resize(n, 0);
+    c->adjacency_offsets.resize(n + 1, 0);
+
+    for (std::size_t i = 0 ; i < n ; ++i) {
+        const mesh_map_t::VertexHandle vh = link.vertexHandle(static_cast<int>(i));
+        const cslibs_math_3d::Vector3d p  = link.getPoint(vh);
+        const cslibs_math_3d::Vector3d nm = link.getNormal(vh);
+        c->x[i]  = p(0);  c->y[i]  = p(1);  c->z[i]  = p(2);
+        c->nx[i] = nm(0); c->ny[i] = nm(1); c->nz[i] = nm(2);
+        c->boundary[i] = link.mesh_.is_boundary(vh) ? 1 : 0;
+
+        const auto &neighbours = link.getNeighbors(vh);
+        c->adjacency_offsets[i + 1] = c->adjacency_offsets[i] + static_cast<index_t>(neighbours.size());
+        for (const mesh_map_t::VertexHandle &nh : neighbours)
+            c->adjacency.emplace_back(static_cast<index_t>(nh.idx()));
+    }
+
+    /// every undirected edge once, adjacency entries point back to it
+    c->adjacency_edges.resize(c->adjacency.size());
+    for (index_t i = 0 ; i < n ; ++i) {
+        for (index_t a = c->adjacency_offsets[i] ; a < c->adjacency_offsets[i + 1] ; ++a) {
+            const index_t j = c->adjacency[a];
+            if (i < j) {
+                c->adjacency_edges[a] = static_cast<index_t>(c->edge_from.size());
+                c->edge_from.emplace_back(i);
+                c->edge_to.emplace_back(j);
+                const double l = (c->point(i) - c->point(j)).length();
+                c->edge_length.emplace_back(l);
+                c->edge_length_sum += l;
+            }
+        }
+    }
+    for (index_t i = 0 ; i < n ; ++i) {
+        for (index_t a = c->adjacency_offsets[i] ; a < c->adjacency_offsets[i + 1] ; ++a) {
+            const index_t j = c->adjacency[a];
+            if (i > j) {
+                for (const index_t *b = c->neighboursBegin(j) ; b != c->neighboursEnd(j) ; ++b) {
+                    if (*b == i) {
+                        c->adjacency_edges[a] = c->adjacency_edges[b - c->adjacency.data()];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return c;
+}
+
+/// boundary vertices of a link in base coordinates
+void boundaryInBase(const KinematicSnapshot &kinematics, const CompiledMeshMap &c,
+                    std::vector<index_t> &ids, std::vector<cslibs_math_3d::Vector3d> &points)
+{
+    const cslibs_math_3d::Transform3d &base_T_link = kinematics.baseTLink(c.map_id);
+    ids.clear();
+    points.clear();
+    for (index_t v = 0 ; v < c.numVertices() ; ++v) {
+        if (c.boundary[v]) {
+            ids.emplace_back(v);
+            points.emplace_back(base_T_link * c.point(v));
+        }
+    }
+}
+
+/// CSR layout of (row, value) pairs, values keep their order within a row
+void toCSR(const std::size_t rows, const std::vector<std::pair<index_t, index_t>> &entries,
+           std::vector<index_t> &offsets, std::vector<index_t> &values)
+{
+    offsets.assign(rows + 1, 0);
+    for (const auto &e : entries)
+        ++offsets[e.first + 1];
+    for (std::size_t r = 0 ; r < rows ; ++r)
+        offsets[r + 1] += offsets[r];
+    values.resize(entries.size());
+    std::vector<index_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto &e : entries)
+        values[fill[e.first]++] = e.second;
+}
+
+/// cluster the nodes of the next finer level, i.e. the full resolution vertices for the first level
+void decimate(CompiledMeshMap &c, const double cell_size)
+{
+    const bool first = c.levels.empty();
+    const std::size_t n_finer = first ? c.numVertices() : c.levels.back().size();
+    auto finer_vertex = [&c, first](const index_t i) {
+        return first ? i : c.levels.back().vertices[i];
+    };
+
+    CompiledMeshMap::Level level;
+    level.cell_size = cell_size;
+    level.parent.resize(n_finer);
+
+    /// grid cells of the representative positions become the clusters
+    std::unordered_map<uint64_t, index_t> cells;
+    std::vector<cslibs_math_3d::Vector3d> centroids;
+    std::vector<std::size_t> counts;
+    auto cell = [cell_size](const double v) {
+        return static_cast<uint64_t>(static_cast<int64_t>(std::floor(v / cell_size)) & 0x1fffff);
+    };
+    for (index_t i = 0 ; i < n_finer ; ++i) {
+        const cslibs_math_3d::Vector3d p = c.point(finer_vertex(i));
+        const uint64_t key = (cell(p(0)) << 42) | (cell(p(1)) << 21) | cell(p(2));
+        auto it = cells.find(key);
+        if (it == cells.end()) {
+            it = cells.emplace(key, static_cast<index_t>(centroids.size())).first;
+            centroids.emplace_back(0.0, 0.0, 0.0);
+            counts.emplace_back(0);
+        }
+        level.parent[i] = it->second;
+        centroids[it->second] = centroids[it->second] + p;
+        ++counts[it->second];
+    }
+
+    /// the member closest to the centroid represents the cluster
+    const std::size_t n = centroids.size();
+    std::vector<double> min_dist(n, std::numeric_limits<double>::max());
+    level.vertices.resize(n);
+    for (index_t i = 0 ; i < n_finer ; ++i) {
+        const index_t k = level.parent[i];
+        const double d = (c.point(finer_vertex(i)) - centroids[k] * (1.0 / counts[k])).length2();
+        if (d < min_dist[k]) {
+            min_dist[k] = d;
+            level.vertices[k] = finer_vertex(i);
+        }
+    }
+
+    std::vector<std::pair<index_t, index_t>> entries;
+    for (index_t i = 0 ; i < n_finer ; ++i)
+        entries.emplace_back(level.parent[i], i);
+    toCSR(n, entries, level.children_offsets, level.children);
+
+    /// clusters are adjacent if any of their finer nodes are
+    entries.clear();
+    for (index_t i = 0 ; i < n_finer ; ++i) {
+        const index_t *begin = first ? c.neighboursBegin(i) : c.levels.back().adjacency.data() + c.levels.back().adjacency_offsets[i];
+        const index_t *end   = first ? c.neighboursEnd(i)   : c.levels.back().adjacency.data() + c.levels.back().adjacency_offsets[i + 1];
+        for (const index_t *j = begin ; j != end ; ++j) {
+            if (level.parent[i] != level.parent[*j])
+                entries.emplace_back(level.parent[i], level.parent[*j]);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    toCSR(n, entries, level.adjacency_offsets, level.adjacency);
+
+    level.cluster.resize(c.numVertices());
+    entries.clear();
+    for (index_t v = 0 ; v < c.numVertices() ; ++v) {
+        level.cluster[v] = level.parent[first ? v : c.levels.back().cluster[v]];
+        if (c.boundary[v])
+            entries.emplace_back(level.cluster[v], v);
+    }
+    toCSR(n, entries, level.boundary_offsets, level.boundary);
+
+    c.levels.emplace_back(std::move(level));
+}
+
+/// run job(i) for i in [0, n), on the pool if there is one
+template <typename job_t>
+void run(ThreadPool *pool, const std::size_t n, const job_t &job)
+{
+    if (pool) {
+        pool->run(n, job);
+    } else {
+        for (std::size_t i = 0 ; i < n ; ++i)
+            job(i);
+    }
+}
+}
+
+CompiledMeshMapTree::Ptr CompiledMeshMapTree::build(const mesh_map_tree_t &tree,
+                                                    ThreadPool *pool)
+{
+    std::vector<const mesh_map_tree_node_t*> nodes;
+    for (const mesh_map_tree_node_t::Ptr &node : tree)
+        nodes.emplace_back(node.get());
+
+    /// links only read their own mesh, so they can be compiled independently
+    std::vector<CompiledMeshMap::Ptr> maps(nodes.size());
+    std::vector<double>               durations(nodes.size());
+    const ros::WallTime start = ros::WallTime::now();
+    run(pool, nodes.size(), [&nodes, &maps, &durations](const std::size_t i) {
+        const ros::WallTime link_start = ros::WallTime::now();
+        maps[i] = compile(*nodes[i]);
+        durations[i] = (ros::WallTime::now() - link_start).toSec();
+    });
+
+    Ptr t(new CompiledMeshMapTree);
+    for (std::size_t i = 0 ; i < maps.size() ; ++i) {
+        ROS_INFO_STREAM("[CompiledMeshMapTree]: Compiled link " << maps[i]->frame_id << " with "
+                        << maps[i]->numVertices() << " vertices in " << durations[i] * 1e3 << "ms.");
+        t->insert(maps[i]);
+    }
+    ROS_INFO_STREAM("[CompiledMeshMapTree]: Compiled " << maps.size() << " links in "
+                    << (ros::WallTime::now() - start).toSec() * 1e3 << "ms.");
+    return t;
+}
+
+CompiledMeshMapTree::ConstPtr CompiledMeshMapTree::withJumpTargets(const KinematicSnapshot &kinematics,
+                                                                   ThreadPool *pool) const
+{
+    Ptr t(new CompiledMeshMapTree);
+    t->maps_               = maps_;
+    t->kinematics_version_ = kinematics.version();
+    t->jump_offsets_.resize(maps_.size());
+    t->jumps_.resize(maps_.size());
+
+    /// links are adjacent if one is the parent of the other
+    std::vector<std::vector<std::size_t>> adjacent(maps_.size());
+    for (std::size_t m = 0 ; m < maps_.size() ; ++m) {
+        const std::size_t p = kinematics.parent(m);
+        if (!maps_[m] || !kinematics.node(m) || p >= maps_.size() || !maps_[p])
+            continue;
+        adjacent[m].emplace_back(p);
+        adjacent[p].emplace_back(m);
+    }
+
+    std::vector<std::vector<index_t>>                  ids(maps_.size());
+    std::vector<std::vector<cslibs_math_3d::Vector3d>> points(maps_.size());
+    for (std::size_t m = 0 ; m < maps_.size() ; ++m) {
+        if (maps_[m] && kinematics.node(m))
+            boundaryInBase(kinematics, *maps_[m], ids[m], points[m]);
+    }
+
+    /// the nearest boundary vertex of every adjacent link is the jump target
+    run(pool, maps_.size(), [this, &t, &adjacent, &ids, &points](const std::size_t m) {
+        if (!maps_[m])
+            return;
+        const CompiledMeshMap &c = *maps_[m];
+        std::vector<std::vector<JumpTarget>> targets(c.numVertices());
+        for (std::size_t b = 0 ; b < ids[m].size() ; ++b) {
+            for (const std::size_t o : adjacent[m]) {
+                double  min_dist = std::numeric_limits<double>::max();
+                index_t nearest  = 0;
+                for (std::size_t k = 0 ; k < ids[o].size() ; ++k) {
+                    const double d = (points[o][k] - points[m][b]).length2();
+                    if (d < min_dist) {
+                        min_dist = d;
+                        nearest  = ids[o][k];
+                    }
+                }
+                if (!ids[o].empty())
+                    targets[ids[m][b]].emplace_back(JumpTarget{static_cast<index_t>(o), nearest});
+            }
+        }
+
+        std::vector<index_t>    &offsets = t->jump_offsets_[m];
+        std::vector<JumpTarget> &jumps   = t->jumps_[m];
+        offsets.assign(c.numVertices() + 1, 0);
+        for (std::size_t v = 0 ; v < targets.size() ; ++v) {
+            jumps.insert(jumps.end(), targets[v].begin(), targets[v].end());
+            offsets[v + 1] = static_cast<index_t>(jumps.size());
+        }
+    });
+    return t;
+}
+
+void CompiledMeshMapTree::buildLevels(const std::vector<double> &cell_sizes,
+                                      ThreadPool *pool)
+{
+    const ros::WallTime start = ros::WallTime::now();
+    run(pool, maps_.size(), [this, &cell_sizes](const std::size_t m) {
+        if (!maps_[m])
+            return;
+        maps_[m]->levels.clear();
+        for (const double cell_size : cell_sizes)
+            decimate(*maps_[m], cell_size);
+    });
+
+    for (const CompiledMeshMap::Ptr &c : maps_) {
+        if (!c)
+            continue;
+        std::ostringstream sizes;
+        for (const CompiledMeshMap::Level &l : c->levels)
+            sizes << " " << l.size();
+        ROS_INFO_STREAM("[CompiledMeshMapTree]: Levels of link " << c->frame_id << ":" << sizes.str());
+    }
+    ROS_INFO_STREAM("[CompiledMeshMapTree]: Built " << cell_sizes.size() << " levels in "
+                    << (ros::WallTime::now() - start).toSec() * 1e3 << "ms.");
+}
+}
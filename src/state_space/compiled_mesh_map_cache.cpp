@@ -0,0 +1,303 @@
+#include <muse_armcl/state_space/compiled_mesh_map_cache.hpp>
+#include <muse_armcl/common/binary_io.hpp>
+
+#include <ros/console.h>
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+#include <sys/stat.h>
+
+namespace muse_armcl {
+namespace {
+const char     MAGIC[8] = {'M', 'A', 'R', 'M', 'C', 'L', 'M', 'M'};
+const uint32_t VERSION  = 3;
+
+struct Header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t n_maps;
+};
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME  = 1099511628211ull;
+
+inline void fnv(uint64_t &h, const char *data, const std::size_t size)
+{
+    for (std::size_t i = 0 ; i < size ; ++i) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= FNV_PRIME;
+    }
+}
+
+inline void fnv(uint64_t &h, const std::string &s)
+{
+    const uint64_t size = s.size();
+    fnv(h, reinterpret_cast<const char*>(&size), sizeof(size));
+    fnv(h, s.data(), s.size());
+}
+
+/// offsets have to start at zero, grow monotonically and end at the number of entries
+bool validOffsets(const std::vector<CompiledMeshMap::index_t> &offsets, const std::size_t n_entries)
+{
+    if (offsets.front() != 0 || offsets.back() != n_entries)
+        return false;
+    for (std::size_t i = 0 ; i + 1 < offsets.size() ; ++i) {
+        if (offsets[i] > offsets[i + 1])
+            return false;
+    }
+    return true;
+}
+
+bool validIndices(const std::vector<CompiledMeshMap::index_t> &indices, const std::size_t n)
+{
+    for (const CompiledMeshMap::index_t i : indices) {
+        if (i >= n)
+            return false;
+    }
+    return true;
+}
+
+bool readLevel(BinaryReader &r, const std::size_t n_vertices, const std::size_t n_finer, CompiledMeshMap::Level &l)
+{
+    uint64_t n_clusters, n_adjacency, n_boundary;
+    if (!r.read(l.cell_size) || !r.read(n_clusters) || !r.read(n_adjacency) || !r.read(n_boundary))
+        return false;
+    if (!r.read(l.vertices, n_clusters) ||
+            !r.read(l.cluster, n_vertices) ||
+            !r.read(l.parent, n_finer) ||
+            !r.read(l.children_offsets, n_clusters + 1) ||
+            !r.read(l.children, n_finer) ||
+            !r.read(l.adjacency_offsets, n_clusters + 1) ||
+            !r.read(l.adjacency, n_adjacency) ||
+            !r.read(l.boundary_offsets, n_clusters + 1) ||
+            !r.read(l.boundary, n_boundary))
+        return false;
+
+    return validOffsets(l.children_offsets, n_finer) &&
+           validOffsets(l.adjacency_offsets, n_adjacency) &&
+           validOffsets(l.boundary_offsets, n_boundary) &&
+           validIndices(l.vertices, n_vertices) &&
+           validIndices(l.cluster, n_clusters) &&
+           validIndices(l.parent, n_clusters) &&
+           validIndices(l.children, n_finer) &&
+           validIndices(l.adjacency, n_clusters) &&
+           validIndices(l.boundary, n_vertices);
+}
+
+void writeLevel(BinaryWriter &w, const CompiledMeshMap::Level &l)
+{
+    w.write(l.cell_size);
+    w.write(static_cast<uint64_t>(l.size()));
+    w.write(static_cast<uint64_t>(l.adjacency.size()));
+    w.write(static_cast<uint64_t>(l.boundary.size()));
+    w.write(l.vertices);
+    w.write(l.cluster);
+    w.write(l.parent);
+    w.write(l.children_offsets);
+    w.write(l.children);
+    w.write(l.adjacency_offsets);
+    w.write(l.adjacency);
+    w.write(l.boundary_offsets);
+    w.write(l.boundary);
+}
+
+bool readMap(BinaryReader &r, CompiledMeshMap &c)
+{
+    uint64_t map_id, n_vertices, n_adjacency, n_edges;
+    if (!r.read(map_id) || !r.read(c.frame_id) ||
+            !r.read(n_vertices) || !r.read(n_adjacency) || !r.read(n_edges) ||
+            !r.read(c.edge_length_sum))
+        return false;
+    c.map_id = map_id;
+
+    for (auto *v : {&c.x, &c.y, &c.z, &c.nx, &c.ny, &c.nz}) {
+        if (!r.read(*v, n_vertices))
+            return false;
+    }
+    if (!r.read(c.boundary, n_vertices) ||
+            !r.read(c.adjacency_offsets, n_vertices + 1) ||
+            !r.read(c.adjacency, n_adjacency) ||
+            !r.read(c.adjacency_edges, n_adjacency) ||
+            !r.read(c.edge_from, n_edges) ||
+            !r.read(c.edge_to, n_edges) ||
+            !r.read(c.edge_length, n_edges))
+        return false;
+
+    /// reject corrupted indices instead of reading out of bounds later
+    if (!validOffsets(c.adjacency_offsets, n_adjacency) ||
+            !validIndices(c.adjacency, n_vertices) ||
+            !validIndices(c.adjacency_edges, n_edges) ||
+            !validIndices(c.edge_from, n_vertices) ||
+            !validIndices(c.edge_to, n_vertices))
+        return false;
+
+    /// every level refines the next coarser one, the first one the full resolution
+    uint64_t n_levels;
+    if (!r.read(n_levels))
+        return false;
+    for (uint64_t i = 0 ; i < n_levels ; ++i) {
+        const std::size_t n_finer = c.levels.empty() ? n_vertices : c.levels.back().size();
+        c.levels.emplace_back();
+        if (!readLevel(r, n_vertices, n_finer, c.levels.back()))
+            return false;
+    }
+    return true;
+}
+
+void writeMap(BinaryWriter &w, const CompiledMeshMap &c)
+{
+    w.write(static_cast<uint64_t>(c.map_id));
+    w.write(c.frame_id);
+    w.write(static_cast<uint64_t>(c.numVertices()));
+    w.write(static_cast<uint64_t>(c.adjacency.size()));
+    w.write(static_cast<uint64_t>(c.numEdges()));
+    w.write(c.edge_length_sum);
+    for (const auto *v : {&c.x, &c.y, &c.z, &c.nx, &c.ny, &c.nz})
+        w.write(*v);
+    w.write(c.boundary);
+    w.write(c.adjacency_offsets);
+    w.write(c.adjacency);
+    w.write(c.adjacency_edges);
+    w.write(c.edge_from);
+    w.write(c.edge_to);
+    w.write(c.edge_length);
+    w.write(static_cast<uint64_t>(c.levels.size()));
+    for (const CompiledMeshMap::Level &l : c.levels)
+        writeLevel(w, l);
+}
+}
+
+uint64_t CompiledMeshMapCache::key(const std::string              &path,
+                                   const std::vector<std::string> &files,
+                                   const std::vector<std::string> &parent_ids,
+                                   const std::vector<std::string> &frame_ids,
+                                   const std::vector<double>      &cell_sizes)
+{
+    uint64_t h = FNV_OFFSET;
+    fnv(h, reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    fnv(h, std::to_string(cell_sizes.size()));
+    fnv(h, reinterpret_cast<const char*>(cell_sizes.data()), cell_sizes.size() * sizeof(double));
+    for (const std::vector<std::string> *ids : {&parent_ids, &frame_ids, &files}) {
+        fnv(h, std::to_string(ids->size()));
+        for (const std::string &id : *ids)
+            fnv(h, id);
+    }
+
+    /// only the file metadata is hashed, touching a mesh regenerates the cache
+    const std::string prefix = path.empty() || path.back() == '/' ? path : path + "/";
+    for (const std::string &file : files) {
+        const std::string full = prefix + file;
+        fnv(h, full);
+        struct stat st;
+        if (::stat(full.c_str(), &st) != 0) {
+            /// unreadable meshes must never match an existing cache
+            fnv(h, "<missing>");
+            continue;
+        }
+        const int64_t meta[3] = {static_cast<int64_t>(st.st_size),
+                                 static_cast<int64_t>(st.st_mtim.tv_sec),
+                                 static_cast<int64_t>(st.st_mtim.tv_nsec)};
+        fnv(h, reinterpret_cast<const char*>(meta), sizeof(meta));
+    }
+    return h;
+}
+
+CompiledMeshMapTree::Ptr CompiledMeshMapCache::load(const std::string                  &file,
+                                                    const uint64_t                      key,
+                                                    const cslibs_mesh_map::MeshMapTree &tree)
+{
+    const MappedFile mapped(file);
+    if (!mapped.valid())
+        return nullptr;
+
+    CompiledMeshMapTree::Ptr compiled(new CompiledMeshMapTree);
+    BinaryReader r(mapped.data(), mapped.size());
+    Header h;
+    bool valid = r.read(h) &&
+                 std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 h.version == VERSION &&
+                 h.key == key &&
+                 h.n_maps == tree.getNumberOfNodes();
+    for (uint64_t i = 0 ; valid && i < h.n_maps ; ++i) {
+        CompiledMeshMap::Ptr c(new CompiledMeshMap);
+        valid = readMap(r, *c);
+        if (!valid)
+            break;
+
+        /// the cache has to describe the very tree that was loaded
+        const cslibs_mesh_map::MeshMapTreeNode *node = tree.getNode(c->frame_id);
+        valid = node && node->mapId() == c->map_id &&
+                node->map.mesh_.n_vertices() == c->numVertices();
+        if (valid)
+            compiled->insert(c);
+    }
+    return valid ? compiled : nullptr;
+}
+
+bool CompiledMeshMapCache::save(const std::string         &file,
+                                const uint64_t             key,
+                                const CompiledMeshMapTree &compiled)
+{
+    const std::string tmp = file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+
+        Header h;
+        std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version  = VERSION;
+        h.reserved = 0;
+        h.key      = key;
+        h.n_maps   = 0;
+        for (std::size_t m = 0 ; m < compiled.size() ; ++m)
+            h.n_maps += compiled.get(m) ? 1 : 0;
+
+        BinaryWriter w(out);
+        w.write(h);
+        for (std::size_t m = 0 ; m < compiled.size() ; ++m) {
+            if (compiled.get(m))
+                writeMap(w, *compiled.get(m));
+        }
+        if (!out.good()) {
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), file.c_str()) == 0;
+}
+
+CompiledMeshMapTree::Ptr CompiledMeshMapCache::loadOrBuild(const std::string                  &file,
+                                                           const uint64_t                      key,
+                                                           const cslibs_mesh_map::MeshMapTree &tree,
+                                                           const std::vector<double>          &cell_sizes,
+                                                           ThreadPool                         *pool)
+{
+    auto build = [&tree, &cell_sizes, pool]() {
+        CompiledMeshMapTree::Ptr compiled = CompiledMeshMapTree::build(tree, pool);
+        if (!cell_sizes.empty())
+            compiled->buildLevels(cell_sizes, pool);
+        return compiled;
+    };
+    if (file.empty())
+        return build();
+
+    CompiledMeshMapTree::Ptr compiled = load(file, key, tree);
+    if (compiled) {
+        ROS_INFO_STREAM("[CompiledMeshMapCache]: Loaded compiled map from '" << file << "'.");
+        return compiled;
+    }
+
+    compiled = build();
+    if (save(file, key, *compiled))
+        ROS_INFO_STREAM("[CompiledMeshMapCache]: Regenerated '" << file << "'.");
+    else
+        ROS_WARN_STREAM("[CompiledMeshMapCache]: Cannot write '" << file << "'.");
+    return compiled;
+}
+}
@@ -2,8 +2,11 @@
 #include <thread>
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
 
 #include <muse_armcl/state_space/mesh_map_provider.hpp>
+#include <muse_armcl/state_space/compiled_mesh_map_cache.hpp>
+#include <muse_armcl/state_space/mesh_map_tree_loader.hpp>
 #include <cslibs_math_ros/tf/conversion_3d.hpp>
 #include <cslibs_mesh_map/cslibs_mesh_map_visualization.h>
 #include <ros/ros.h>
@@ -20,11 +23,25 @@ public:
         return map_;
     }
 
+    virtual ~MeshMapLoader()
+    {
+        stop();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
     void waitForStateSpace() const override
     {
+        /// wait in slices, so a shutdown or an unload cannot block forever
         std::unique_lock<std::mutex> l(map_mutex_);
-        if (!map_)
-            notify_.wait(l);
+        while (!map_ && !stop_ && ros::ok())
+            notify_.wait_for(l, std::chrono::milliseconds(100));
+    }
+
+    void stop() override
+    {
+        stop_ = true;
+        notify_.notify_all();
     }
 
     void doSetup(ros::NodeHandle &nh) override
@@ -35,6 +52,13 @@ public:
         files_       = nh.param<std::vector<std::string>>(param_name("meshes"),     std::vector<std::string>());
         parent_ids_  = nh.param<std::vector<std::string>>(param_name("parent_ids"), std::vector<std::string>());
         frame_ids_   = nh.param<std::vector<std::string>>(param_name("frame_ids"),  std::vector<std::string>());
+        cache_file_  = nh.param<std::string>(param_name("cache_file"), "");
+        load_threads_ = std::max(0, nh.param<int>(param_name("load_threads"), 0));
+        lod_cell_sizes_ = nh.param<std::vector<double>>(param_name("lod_cell_sizes"), std::vector<double>());
+        for (std::size_t i = 0 ; i < lod_cell_sizes_.size() ; ++i) {
+            if (lod_cell_sizes_[i] <= 0.0 || (i > 0 && lod_cell_sizes_[i] <= lod_cell_sizes_[i - 1]))
+                throw std::runtime_error("[" + name_ + "]: lod_cell_sizes have to be positive and increasing!");
+        }
 
         pub_surface_ = nh.advertise<visualization_msgs::MarkerArray>("surface",1);
         last_update_ = ros::Time::now();
@@ -45,8 +69,9 @@ public:
                 if (frame_ids_.empty())
                     throw std::runtime_error("[" + name_ + "]: No frame id found!");
 
-                /// load map
-                tree_.loadFromFile(path_, parent_ids_, frame_ids_, files_);
+                /// links are parsed one by one and compiled in parallel, the pool only lives during startup
+                ThreadPool pool(static_cast<std::size_t>(load_threads_));
+                loadMeshMapTree(tree_, path_, parent_ids_, frame_ids_, files_, name_);
 //                mesh_map_tree_node_t* l1 = tree.getNode(frame_ids_.front());
 
                 std::unique_lock<std::mutex> l(map_mutex_);
@@ -57,6 +82,9 @@ public:
                 updateTransformations();
                 first_load_ = false;
 
+                /// jump targets follow the kinematic snapshots of the update model
+                map_->setCompiled(compile(pool));
+
                 /// finish load by unlocking mutex
                 l.unlock();
                 ROS_INFO_STREAM("[" << name_ << "]: Loaded map.");
@@ -81,6 +109,7 @@ private:
     mutable std::mutex                      map_mutex_;
     std::thread                             worker_;
     mutable std::condition_variable         notify_;
+    std::atomic_bool                        stop_{false};
 
     mesh_map_tree_t                         tree_;
     mutable MeshMap::Ptr                    map_;
@@ -91,6 +120,9 @@ private:
     std::vector<std::string>                files_;
     std::vector<std::string>                parent_ids_;
     std::vector<std::string>                frame_ids_;
+    std::string                             cache_file_;
+    int                                     load_threads_;
+    std::vector<double>                     lod_cell_sizes_;
 
     ros::Publisher                          pub_surface_;
     mutable visualization_msgs::MarkerArray markers_;
@@ -130,6 +162,13 @@ private:
         publishMarkers();
     }
 
+    inline CompiledMeshMapTree::Ptr compile(ThreadPool &pool) const
+    {
+        const uint64_t key = cache_file_.empty() ? 0 : CompiledMeshMapCache::key(path_, files_, parent_ids_, frame_ids_, lod_cell_sizes_);
+        CompiledMeshMapTree::Ptr compiled = CompiledMeshMapCache::loadOrBuild(cache_file_, key, tree_, lod_cell_sizes_, &pool);
+        return compiled;
+    }
+
     inline void resetMarkers() const
     {
         markers_.markers.clear();
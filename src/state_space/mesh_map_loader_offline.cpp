@@ -5,6 +5,8 @@
 
 #include <muse_armcl/state_space/transform_graph.h>
 #include <muse_armcl/state_space/mesh_map_provider.hpp>
+#include <muse_armcl/state_space/compiled_mesh_map_cache.hpp>
+#include <muse_armcl/state_space/mesh_map_tree_loader.hpp>
 #include <cslibs_math_ros/tf/conversion_3d.hpp>
 #include <cslibs_mesh_map/cslibs_mesh_map_visualization.h>
 #include <ros/ros.h>
@@ -52,6 +54,13 @@ public:
         files_       = nh.param<std::vector<std::string>>(param_name("meshes"),     std::vector<std::string>());
         parent_ids_  = nh.param<std::vector<std::string>>(param_name("parent_ids"), std::vector<std::string>());
         frame_ids_   = nh.param<std::vector<std::string>>(param_name("frame_ids"),  std::vector<std::string>());
+        cache_file_  = nh.param<std::string>(param_name("cache_file"), "");
+        load_threads_ = std::max(0, nh.param<int>(param_name("load_threads"), 0));
+        lod_cell_sizes_ = nh.param<std::vector<double>>(param_name("lod_cell_sizes"), std::vector<double>());
+        for (std::size_t i = 0 ; i < lod_cell_sizes_.size() ; ++i) {
+            if (lod_cell_sizes_[i] <= 0.0 || (i > 0 && lod_cell_sizes_[i] <= lod_cell_sizes_[i - 1]))
+                throw std::runtime_error("[" + name_ + "]: lod_cell_sizes have to be positive and increasing!");
+        }
 
         last_update_ = ros::Time::now();
         auto load = [this]() {
@@ -61,11 +70,15 @@ public:
                 if (frame_ids_.empty())
                     throw std::runtime_error("[" + name_ + "]: No frame id found!");
 
-                /// load map
-                tree_.loadFromFile(path_, parent_ids_, frame_ids_, files_);
+                /// links are parsed one by one and compiled in parallel, the pool only lives during startup
+                ThreadPool pool(static_cast<std::size_t>(load_threads_));
+                loadMeshMapTree(tree_, path_, parent_ids_, frame_ids_, files_, name_);
 
 //                std::unique_lock<std::mutex> l(map_mutex_);
                 map_.reset(new MeshMap(&tree_, frame_ids_.front()));
+                const uint64_t key = cache_file_.empty() ? 0 : CompiledMeshMapCache::key(path_, files_, parent_ids_, frame_ids_, lod_cell_sizes_);
+                CompiledMeshMapTree::Ptr compiled = CompiledMeshMapCache::loadOrBuild(cache_file_, key, tree_, lod_cell_sizes_, &pool);
+                map_->setCompiled(compiled);
 //                l.unlock();
 
                 /// update transformations
@@ -93,16 +106,27 @@ public:
             ROS_INFO_STREAM(tree_.size() << " vs. " << frame_ids_.size());
         }
 
-        bool set_all = true;
+        /// all link transforms are resolved in one batch
+        std::vector<mesh_map_tree_node_t*> links;
+        std::vector<std::string> parents, frames;
         for(mesh_map_tree_node_t::Ptr m : tree_){
-            std::string frame_id = m->frameId();
             std::string parent = "";
-            bool has_parent = m->parentFrameId(parent);
-            ROS_INFO_STREAM("[" << name_ << "]: " << parent << ", " << frame_id);
-            if(has_parent){
-                std::unique_lock<std::mutex> l(map_mutex_);
-                bool found =  tfg.query(parent, frame_id, m->transform);
-                set_all &= found;
+            if(m->parentFrameId(parent)){
+                links.emplace_back(m.get());
+                parents.emplace_back(parent);
+                frames.emplace_back(m->frameId());
+            }
+        }
+        TransformGraph::transform_vector_t link_transforms;
+        std::vector<uint8_t> found;
+        bool set_all = tfg.query(parents, frames, link_transforms, found);
+        {
+            std::unique_lock<std::mutex> l(map_mutex_);
+            for(std::size_t i = 0 ; i < links.size() ; ++i){
+                if(found[i])
+                    links[i]->transform = link_transforms[i];
+                else
+                    ROS_WARN_STREAM("[" << name_ << "]: no transform " << parents[i] << " <- " << frames[i]);
             }
         }
         if(set_all){
@@ -132,6 +156,9 @@ private:
     std::vector<std::string>                files_;
     std::vector<std::string>                parent_ids_;
     std::vector<std::string>                frame_ids_;
+    std::string                             cache_file_;
+    int                                     load_threads_;
+    std::vector<double>                     lod_cell_sizes_;
 
     std::atomic_bool                        stop_waiting_you_son_of_a_bitch_;
     std::atomic_bool                        set_tf_;
@@ -4,13 +4,27 @@
 #include <cslibs_mesh_map/mesh_map_tree.h>
 #include <cslibs_mesh_map/cslibs_mesh_map_visualization.h>
 #include <cslibs_math_3d/linear/pointcloud.hpp>
-#include <cslibs_math_ros/sensor_msgs/conversion_3d.hpp>
 #include <cslibs_math_ros/geometry_msgs/conversion_3d.hpp>
 
 #include <visualization_msgs/MarkerArray.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <cslibs_kdl_msgs/ContactMessageArray.h>
+
+#include <algorithm>
+#include <cstring>
+
 namespace muse_armcl {
+StatePublisher::~StatePublisher()
+{
+    {
+        std::unique_lock<std::mutex> lock(frame_mutex_);
+        stop_ = true;
+    }
+    frame_notify_.notify_one();
+    if (worker_.joinable())
+        worker_.join();
+}
+
 void StatePublisher::setup(ros::NodeHandle &nh, map_provider_map_t &map_providers)
 {
     const std::string map_provider_id = nh.param<std::string>("map", ""); /// toplevel parameter
@@ -25,6 +39,7 @@ void StatePublisher::setup(ros::NodeHandle &nh, map_provider_map_t &map_provider
     const std::string topic_particles     = nh.param<std::string>("topic_particles", "particles");
     const std::string topic_contacts      = nh.param<std::string>("topic_contacts", "contacts");
     const std::string topic_contacts_vis  = nh.param<std::string>("topic_contacts_visualization", "contacts_visualization");
+    const std::string topic_probabilities = nh.param<std::string>("topic_probabilities", "contact_probabilities");
 
     contact_marker_r_ = nh.param<double>("contact_marker_r", 0.0);
     contact_marker_g_ = nh.param<double>("contact_marker_g", 0.0);
@@ -36,6 +51,28 @@ void StatePublisher::setup(ros::NodeHandle &nh, map_provider_map_t &map_provider
 
     no_contact_torque_threshold_ = nh.param<double>("no_contact_threshold", 0.1);
 
+    const std::string cloud_mode = nh.param<std::string>("particles_mode", "all");
+    if (cloud_mode == "all")
+        cloud_mode_ = CloudMode::ALL;
+    else if (cloud_mode == "top_n")
+        cloud_mode_ = CloudMode::TOP_N;
+    else if (cloud_mode == "per_vertex")
+        cloud_mode_ = CloudMode::PER_VERTEX;
+    else
+        throw std::runtime_error("[StatePublisher]: Unknown particles_mode '" + cloud_mode + "', use all, top_n or per_vertex!");
+    cloud_max_points_ = static_cast<std::size_t>(std::max(1, nh.param<int>("particles_max", 1000)));
+
+    const double rate_particles = nh.param<double>("rate_particles", 10.0);
+    const double rate_contacts  = nh.param<double>("rate_contacts", 0.0);
+    const double rate_probabilities = nh.param<double>("rate_probabilities", 0.0);
+    particles_period_     = ros::WallDuration(rate_particles > 0.0 ? 1.0 / rate_particles : 0.0);
+    contacts_period_      = ros::WallDuration(rate_contacts > 0.0 ? 1.0 / rate_contacts : 0.0);
+    probabilities_period_ = ros::WallDuration(rate_probabilities > 0.0 ? 1.0 / rate_probabilities : 0.0);
+
+    probabilities_delta_     = nh.param<bool>("probabilities_delta", false);
+    probabilities_threshold_ = nh.param<double>("probabilities_delta_threshold", 1e-4);
+    probabilities_keyframe_  = static_cast<std::size_t>(std::max(1, nh.param<int>("probabilities_keyframe", 10)));
+
     std::string path;
     path = nh.param<std::string>("contact_points_file", std::string(""));
     if(path != ""){
@@ -53,6 +90,11 @@ void StatePublisher::setup(ros::NodeHandle &nh, map_provider_map_t &map_provider
     pub_particles_     = nh.advertise<sensor_msgs::PointCloud2>(topic_particles, 10);
     pub_contacts_      = nh.advertise<cslibs_kdl_msgs::ContactMessageArray>(topic_contacts, 10);
     pub_contacts_vis_  = nh.advertise<visualization_msgs::MarkerArray>(topic_contacts_vis, 1);
+    /// deltas are only meaningful in order and complete, so they are never dropped by a short queue
+    pub_probabilities_ = nh.advertise<ContactProbabilities>(topic_probabilities, probabilities_delta_ ? 100 : 1);
+
+    if (!worker_.joinable())
+        worker_ = std::thread([this]() { loop(); });
 }
 
 void StatePublisher::publish(const sample_set_t::ConstPtr &sample_set)
@@ -75,70 +117,141 @@ void StatePublisher::publish(const sample_set_t::ConstPtr &sample_set, const boo
     if (!map_provider_)
         return;
 
+    /// decide on the filter thread which topics are due, so nothing is copied for idle topics
+    const ros::WallTime now = ros::WallTime::now();
+    const bool particles = pub_particles_.getNumSubscribers() > 0 && now >= next_particles_;
+    const bool contacts  = publish_contacts && now >= next_contacts_ &&
+                           (pub_contacts_.getNumSubscribers() > 0 || pub_contacts_vis_.getNumSubscribers() > 0);
+    const bool probabilities = publish_contacts && now >= next_probabilities_ &&
+                               pub_probabilities_.getNumSubscribers() > 0;
+    if (!particles && !contacts && !probabilities)
+        return;
+
     /// get the map
     const muse_smc::StateSpace<StateSpaceDescription>::ConstPtr ss = map_provider_->getStateSpace();
     if (!ss->isType<MeshMap>())
         return;
 
-    const mesh_map_tree_t* map = ss->as<MeshMap>().data();
-    uint64_t nsecs = static_cast<uint64_t>(sample_set->getStamp().nanoseconds());
-    const ros::Time stamp = ros::Time().fromNSec(nsecs);
-
-    publishSet(sample_set, map, stamp);
-
-
-    if (publish_contacts) {
-        visualization_msgs::Marker msg;
-        msg.lifetime = ros::Duration(0.2);
-        msg.color.a = 0.8;
-        msg.color.r = contact_marker_r_;
-        msg.color.g = contact_marker_g_;
-        msg.color.b = contact_marker_b_;
-        msg.scale.x = contact_marker_scale_x_;
-        msg.scale.y = contact_marker_scale_y_;
-        msg.scale.z = contact_marker_scale_z_;
-        msg.ns = "contact";
-        msg.type = visualization_msgs::Marker::ARROW;
-        msg.action = visualization_msgs::Marker::MODIFY;
-        msg.points.resize(2);
-
-        /// density estimation
-        ContactPointHistogram::ConstPtr histogram = std::dynamic_pointer_cast<ContactPointHistogram const>(sample_set->getDensity());
-        if(histogram && !labeled_contact_points_.empty()){
-            std::vector<std::pair<int,double>> labels;
-            histogram->getTopLabels(labels);
-            publishDiscretePoints(labels, stamp, msg);
-        } else {
-            publishContacts(sample_set, map, stamp, msg);
+    const KinematicSnapshot::ConstPtr kinematics = ss->as<MeshMap>().snapshot();
+    if (!kinematics)
+        return;
+    if (particles)
+        next_particles_ = now + particles_period_;
+    if (contacts)
+        next_contacts_ = now + contacts_period_;
+    if (probabilities)
+        next_probabilities_ = now + probabilities_period_;
+
+    const uint64_t nsecs = static_cast<uint64_t>(sample_set->getStamp().nanoseconds());
+    {
+        /// a frame the publishing thread did not pick up yet is replaced, the buffers are reused
+        std::unique_lock<std::mutex> lock(frame_mutex_);
+        Frame &frame = pending_;
+        frame.nsecs       = nsecs;
+        frame.stamp       = ros::Time().fromNSec(nsecs);
+        frame.state_space = ss;
+        frame.kinematics  = kinematics;
+        frame.particles   = particles || (has_pending_ && frame.particles);
+        frame.contacts    = contacts  || (has_pending_ && frame.contacts);
+        frame.probabilities = probabilities || (has_pending_ && frame.probabilities);
+        frame.discrete    = false;
+        frame.samples.clear();
+        frame.detected.clear();
+        frame.labels.clear();
+
+        if (frame.particles || frame.probabilities) {
+            const auto &samples = sample_set->getSamples();
+            frame.samples.assign(samples.begin(), samples.end());
+        }
+        if (frame.contacts) {
+            /// density estimation
+            ContactPointHistogram::ConstPtr histogram = std::dynamic_pointer_cast<ContactPointHistogram const>(sample_set->getDensity());
+            SampleDensity::ConstPtr density = std::dynamic_pointer_cast<SampleDensity const>(sample_set->getDensity());
+            if (histogram && !labeled_contact_points_.empty()) {
+                histogram->getTopLabels(frame.labels);
+                frame.discrete = true;
+            } else if (density) {
+                density->contacts(frame.detected);
+            } else {
+                std::cerr << "[StatePublisher]: Incomaptible sample density estimation!" << "\n";
+                frame.contacts = false;
+            }
         }
+        has_pending_ = true;
+    }
+    frame_notify_.notify_one();
+}
 
+void StatePublisher::loop()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(frame_mutex_);
+            frame_notify_.wait(lock, [this]() { return stop_ || has_pending_; });
+            if (stop_)
+                return;
+            std::swap(pending_, working_);
+            has_pending_ = false;
+        }
+        publishFrame(working_);
     }
 }
-void StatePublisher::publishContacts(const typename sample_set_t::ConstPtr & sample_set,
-                                     const mesh_map_tree_t* map,
-                                     const ros::Time& stamp,
-                                     visualization_msgs::Marker& msg)
+
+void StatePublisher::publishFrame(const Frame &frame)
 {
-    visualization_msgs::MarkerArray markers;
-    msg.header.stamp = stamp;
-    msg.id = 0;
+    /// the weights per vertex are shared by the per vertex cloud and the probability field
+    if ((frame.particles && cloud_mode_ == CloudMode::PER_VERTEX) || frame.probabilities)
+        aggregateVertices(frame);
+    if (frame.particles)
+        publishSet(frame);
+    if (frame.probabilities)
+        publishProbabilities(frame);
+    if (!frame.contacts)
+        return;
 
-    SampleDensity::ConstPtr density = std::dynamic_pointer_cast<SampleDensity const>(sample_set->getDensity());
-    if (!density) {
-        std::cerr << "[StatePublisher]: Incomaptible sample density estimation!" << "\n";
+    if (contacts_stamp_ == frame.nsecs && contacts_msg_) {
+        pub_contacts_.publish(contacts_msg_);
+        pub_contacts_vis_.publish(contacts_markers_);
         return;
     }
 
-    /// publish all detected contacts
-    std::vector<StateSpaceDescription::sample_t, StateSpaceDescription::sample_t::allocator_t> states;
-    density->contacts(states);
-    //        std::cout << "[StatePublisher]: number of contacts: " << states.size() << std::endl;
+    contacts_stamp_ = frame.nsecs;
+    visualization_msgs::Marker msg;
+    msg.lifetime = ros::Duration(0.2);
+    msg.color.a = 0.8;
+    msg.color.r = contact_marker_r_;
+    msg.color.g = contact_marker_g_;
+    msg.color.b = contact_marker_b_;
+    msg.scale.x = contact_marker_scale_x_;
+    msg.scale.y = contact_marker_scale_y_;
+    msg.scale.z = contact_marker_scale_z_;
+    msg.ns = "contact";
+    msg.type = visualization_msgs::Marker::ARROW;
+    msg.action = visualization_msgs::Marker::MODIFY;
+    msg.points.resize(2);
+
+    if (frame.discrete)
+        publishDiscretePoints(frame.labels, frame.stamp, msg);
+    else
+        publishContacts(frame, msg);
+}
 
+void StatePublisher::publishContacts(const Frame &frame,
+                                     visualization_msgs::Marker& msg)
+{
+    const KinematicSnapshot &kinematics = *frame.kinematics;
+    const ros::Time &stamp = frame.stamp;
+    contacts_msg_.reset(new cslibs_kdl_msgs::ContactMessageArray);
+    contacts_markers_.reset(new visualization_msgs::MarkerArray);
+    visualization_msgs::MarkerArray &markers = *contacts_markers_;
+    msg.header.stamp = stamp;
+    msg.id = 0;
 
-    cslibs_kdl_msgs::ContactMessageArray contact_msg;
-    bool diff_colors = states.size() > 1;
-    for (const StateSpaceDescription::sample_t& p : states) {
-        const mesh_map_tree_node_t* p_map = map->getNode(p.state.map_id);
+    /// publish all detected contacts
+    cslibs_kdl_msgs::ContactMessageArray &contact_msg = *contacts_msg_;
+    bool diff_colors = frame.detected.size() > 1;
+    for (const StateSpaceDescription::sample_t& p : frame.detected) {
+        const mesh_map_tree_node_t* p_map = kinematics.node(p.state.map_id);
         if (p_map && std::fabs(p.state.force) > 1e-3){
 
             cslibs_kdl_msgs::ContactMessage contact;
@@ -167,40 +280,198 @@ void StatePublisher::publishContacts(const typename sample_set_t::ConstPtr & sam
         }
     }
 
-    pub_contacts_.publish(contact_msg);
-    pub_contacts_vis_.publish(markers);
+    pub_contacts_.publish(contacts_msg_);
+    pub_contacts_vis_.publish(contacts_markers_);
+}
+
+void StatePublisher::publishSet(const Frame &frame)
+{
+    const MeshMap &map = frame.state_space->as<MeshMap>();
+    const KinematicSnapshot &kinematics = *frame.kinematics;
+
+    /// x, y, z and packed rgb as float32, written straight into the message
+    const uint32_t point_step = 4 * sizeof(float);
+    if (!cloud_ || !cloud_.unique()) {
+        cloud_.reset(new sensor_msgs::PointCloud2);
+        cloud_->fields.resize(4);
+        const char *names[] = {"x", "y", "z", "rgb"};
+        for (uint32_t i = 0 ; i < 4 ; ++i) {
+            cloud_->fields[i].name     = names[i];
+            cloud_->fields[i].offset   = i * sizeof(float);
+            cloud_->fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+            cloud_->fields[i].count    = 1;
+        }
+        cloud_->height       = 1;
+        cloud_->point_step   = point_step;
+        cloud_->is_bigendian = false;
+        cloud_->is_dense     = true;
+    }
+    sensor_msgs::PointCloud2 &cloud = *cloud_;
+    cloud.header.frame_id = map.data()->front()->frameId();
+    cloud.header.stamp    = frame.stamp;
+
+    std::size_t n = 0;
+    auto insert = [&cloud, &n, point_step](const cslibs_math_3d::Point3d &pos, const double value) {
+        const cslibs_math::color::Color<double> color(cslibs_math::color::interpolateColor<double>(value, 0, 1.0));
+        const uint32_t rgb = (static_cast<uint32_t>(color.r * 255.0) << 16) |
+                             (static_cast<uint32_t>(color.g * 255.0) << 8)  |
+                              static_cast<uint32_t>(color.b * 255.0);
+        const float point[4] = {static_cast<float>(pos(0)), static_cast<float>(pos(1)), static_cast<float>(pos(2)), 0.f};
+        uint8_t *dst = cloud.data.data() + n * point_step;
+        std::memcpy(dst, point, sizeof(point));
+        std::memcpy(dst + 3 * sizeof(float), &rgb, sizeof(rgb));
+        ++n;
+    };
+
+    if (cloud_mode_ == CloudMode::PER_VERTEX) {
+        const double max_weight = vertex_max_weight_;
+        std::size_t size = 0;
+        for (const VertexWeights &w : vertex_weights_)
+            size += w.occupied.size();
+        cloud.data.resize(size * point_step);
+
+        StateSpaceDescription::state_t vertex_state;
+        vertex_state.s = 0.0;
+        for (std::size_t map_id = 0 ; map_id < vertex_weights_.size() ; ++map_id) {
+            const VertexWeights &w = vertex_weights_[map_id];
+            if (w.occupied.empty() || !kinematics.node(map_id))
+                continue;
+            vertex_state.map_id = map_id;
+            for (const int v : w.occupied) {
+                vertex_state.active_vertex = cslibs_mesh_map::MeshMap::VertexHandle(v);
+                vertex_state.goal_vertex   = vertex_state.active_vertex;
+                insert(kinematics.baseTLink(map_id) * map.position(vertex_state),
+                       max_weight > 0.0 ? w.weight[v] / max_weight : 0.0);
+            }
+        }
+    } else {
+        cloud_order_.clear();
+        for (std::size_t i = 0 ; i < frame.samples.size() ; ++i) {
+            if (kinematics.node(frame.samples[i].state.map_id))
+                cloud_order_.emplace_back(i);
+        }
+        if (cloud_mode_ == CloudMode::TOP_N && cloud_order_.size() > cloud_max_points_) {
+            const sample_vector_t &samples = frame.samples;
+            std::nth_element(cloud_order_.begin(), cloud_order_.begin() + cloud_max_points_, cloud_order_.end(),
+                             [&samples](const std::size_t a, const std::size_t b) { return samples[a].weight > samples[b].weight; });
+            cloud_order_.resize(cloud_max_points_);
+        }
+        cloud.data.resize(cloud_order_.size() * point_step);
+        for (const std::size_t i : cloud_order_) {
+            const StateSpaceDescription::sample_t &p = frame.samples[i];
+            insert(kinematics.baseTLink(p.state.map_id) * map.position(p.state), p.state.last_update);
+        }
+    }
+
+    cloud.width    = static_cast<uint32_t>(n);
+    cloud.row_step = static_cast<uint32_t>(n) * point_step;
+    cloud.data.resize(cloud.row_step);
+    pub_particles_.publish(cloud_);
 }
 
-void StatePublisher::publishSet(const typename sample_set_t::ConstPtr &sample_set,
-                                const mesh_map_tree_t* map,
-                                const ros::Time& stamp)
+void StatePublisher::publishProbabilities(const Frame &frame)
 {
-    std::shared_ptr<cslibs_math_3d::PointcloudRGB3d> part_cloud(new cslibs_math_3d::PointcloudRGB3d);
-    /// publish all particles
-    for (const StateSpaceDescription::sample_t& p : sample_set->getSamples()) {
-        const mesh_map_tree_node_t* p_map = map->getNode(p.state.map_id);
-        if (p_map) {
-            cslibs_math_3d::Transform3d T = map->getTranformToBase(p_map->map.frame_id_);
-            cslibs_math_3d::Point3d pos = p.state.getPosition(p_map->map);
-            pos = T * pos;
-            cslibs_math::color::Color<double> color(cslibs_math::color::interpolateColor<double>(p.state.last_update,0,1.0));
-            cslibs_math_3d::PointRGB3d point(pos, 0.9f, color);
-            part_cloud->insert(point);
+    const KinematicSnapshot &kinematics = *frame.kinematics;
+
+    /// dense field, one dimension per link labeled with its frame id
+    probabilities_.clear();
+    probabilities_links_.clear();
+    const double norm = vertex_total_weight_ > 0.0 ? 1.0 / vertex_total_weight_ : 0.0;
+    for (std::size_t map_id = 0 ; map_id < kinematics.size() ; ++map_id) {
+        const mesh_map_tree_node_t *node = kinematics.node(map_id);
+        if (!node)
+            continue;
+        const std::size_t n = node->map.mesh_.n_vertices();
+        const std::size_t offset = probabilities_.size();
+        probabilities_.resize(offset + n, 0.f);
+        if (map_id < vertex_weights_.size()) {
+            const VertexWeights &w = vertex_weights_[map_id];
+            for (const int v : w.occupied) {
+                if (static_cast<std::size_t>(v) < n)
+                    probabilities_[offset + v] = static_cast<float>(w.weight[v] * norm);
+            }
+        }
+        std_msgs::MultiArrayDimension dim;
+        dim.label  = node->frameId();
+        dim.size   = static_cast<uint32_t>(n);
+        dim.stride = static_cast<uint32_t>(n);
+        probabilities_links_.emplace_back(dim);
+    }
+
+    if (!probabilities_msg_ || !probabilities_msg_.unique())
+        probabilities_msg_.reset(new ContactProbabilities);
+    ContactProbabilities &msg = *probabilities_msg_;
+    msg.header.stamp = frame.stamp;
+    msg.layout.data_offset = 0;
+
+    /// subscribers that joined since the last message have no field to apply changes to
+    const uint32_t subscribers = pub_probabilities_.getNumSubscribers();
+    const bool joined = subscribers > probabilities_subscribers_;
+    probabilities_subscribers_ = subscribers;
+
+    msg.keyframe = !probabilities_delta_ || joined ||
+                   probabilities_sent_.size() != probabilities_.size() ||
+                   probabilities_since_keyframe_ + 1 >= probabilities_keyframe_;
+    if (msg.keyframe) {
+        msg.layout.dim = probabilities_links_;
+        msg.indices.clear();
+        msg.data       = probabilities_;
+        probabilities_sent_ = probabilities_;
+        probabilities_since_keyframe_ = 0;
+    } else {
+        /// the sent field is updated exactly like the subscribers do it
+        msg.layout.dim.clear();
+        msg.indices.clear();
+        msg.data.clear();
+        for (std::size_t i = 0 ; i < probabilities_.size() ; ++i) {
+            const float delta = probabilities_[i] - probabilities_sent_[i];
+            if (std::fabs(delta) > probabilities_threshold_) {
+                msg.indices.emplace_back(static_cast<uint32_t>(i));
+                msg.data.emplace_back(delta);
+                probabilities_sent_[i] += delta;
+            }
         }
+        ++probabilities_since_keyframe_;
+    }
+    pub_probabilities_.publish(probabilities_msg_);
+}
+
+void StatePublisher::aggregateVertices(const Frame &frame)
+{
+    for (VertexWeights &w : vertex_weights_) {
+        for (const int v : w.occupied)
+            w.weight[v] = 0.0;
+        w.occupied.clear();
+    }
+
+    vertex_max_weight_   = 0.0;
+    vertex_total_weight_ = 0.0;
+    for (const StateSpaceDescription::sample_t &p : frame.samples) {
+        const std::size_t map_id = p.state.map_id;
+        const int v = p.state.s < 0.5 ? p.state.active_vertex.idx() : p.state.goal_vertex.idx();
+        if (v < 0 || p.weight <= 0.0)
+            continue;
+        if (map_id >= vertex_weights_.size())
+            vertex_weights_.resize(map_id + 1);
+        VertexWeights &w = vertex_weights_[map_id];
+        if (static_cast<std::size_t>(v) >= w.weight.size())
+            w.weight.resize(v + 1, 0.0);
+        if (w.weight[v] == 0.0)
+            w.occupied.emplace_back(v);
+        w.weight[v] += p.weight;
+        vertex_max_weight_    = std::max(vertex_max_weight_, w.weight[v]);
+        vertex_total_weight_ += p.weight;
     }
-    sensor_msgs::PointCloud2 cloud;
-    cslibs_math_ros::sensor_msgs::conversion_3d::from<double>(part_cloud, cloud);
-    cloud.header.frame_id = map->front()->frameId();
-    cloud.header.stamp = stamp;
-    pub_particles_.publish(cloud);
 }
 
 void StatePublisher::publishDiscretePoints(const std::vector<std::pair<int, double>>& labels,
                                            const ros::Time& stamp,
                                            visualization_msgs::Marker& msg)
 {
-    cslibs_kdl_msgs::ContactMessageArray contact_msg;
-    visualization_msgs::MarkerArray markers;
+    contacts_msg_.reset(new cslibs_kdl_msgs::ContactMessageArray);
+    contacts_markers_.reset(new visualization_msgs::MarkerArray);
+    cslibs_kdl_msgs::ContactMessageArray &contact_msg = *contacts_msg_;
+    visualization_msgs::MarkerArray &markers = *contacts_markers_;
     msg.header.stamp = stamp;
     for(const std::pair<int, double>& p : labels){
         if(p.first <= 0){
@@ -241,8 +512,8 @@ void StatePublisher::publishDiscretePoints(const std::vector<std::pair<int, doub
 
 
     }
-    pub_contacts_.publish(contact_msg);
-    pub_contacts_vis_.publish(markers);
+    pub_contacts_.publish(contacts_msg_);
+    pub_contacts_vis_.publish(contacts_markers_);
 }
 }
 
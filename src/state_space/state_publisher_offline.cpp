@@ -41,6 +41,9 @@ void StatePublisherOffline::publish(const typename sample_set_t::ConstPtr &sampl
     if (!ss->isType<MeshMap>())
         return;
     const mesh_map_tree_t* map = ss->as<MeshMap>().data();
+    const KinematicSnapshot::ConstPtr kinematics = ss->as<MeshMap>().snapshot();
+    if (!kinematics)
+        return;
 
     // ground truth data
     uint64_t nsecs = static_cast<uint64_t>(sample_set->getStamp().nanoseconds());
@@ -53,14 +56,12 @@ void StatePublisherOffline::publish(const typename sample_set_t::ConstPtr &sampl
         std::cout << nsecs << std::endl;
         throw std::runtime_error("Empty data recieved");
     }
-    // save all map base transfroms
-    std::vector<std::string> frame_ids;
-    map->getFrameIds(frame_ids);
-    std::map<std::string, std::shared_ptr< cslibs_math_3d::Transform3d>> transforms;
-    for(std::string& l : frame_ids){
-        std::shared_ptr<cslibs_math_3d::Transform3d> bTl(new cslibs_math_3d::Transform3d);
-        *bTl = map->getTranformToBase(l);
-        transforms[l] = bTl;
+    // base transforms of all links by frame, taken from the snapshot
+    std::map<std::string, const cslibs_math_3d::Transform3d*> transforms;
+    for(std::size_t map_id = 0 ; map_id < kinematics->size() ; ++map_id){
+        const mesh_map_tree_node_t* node = kinematics->node(map_id);
+        if(node)
+            transforms[node->frameId()] = &kinematics->baseTLink(map_id);
     }
 
     double tau_norm =  gt.state.norm(cslibs_kdl_data::JointStateData::DataType::JOINT_TORQUE);
@@ -159,19 +160,19 @@ void StatePublisherOffline::publish(const typename sample_set_t::ConstPtr &sampl
                 }
             }
         }
-    } else {
-        /// density estimation
+    } else if (tau_norm > no_contact_torque_threshold_) {
+        /// density estimation, only needed if a contact can be detected at all
         SampleDensity::ConstPtr density = std::dynamic_pointer_cast<SampleDensity const>(sample_set->getDensity());
-        std::vector<StateSpaceDescription::sample_t, StateSpaceDescription::sample_t::allocator_t> states;
+        SampleDensity::sample_ptr_vector_t states;
         density->contacts(states);
 
-        for (const StateSpaceDescription::sample_t& p : states) {
-            const mesh_map_tree_node_t* p_map = map->getNode(p.state.map_id);
+        for (const StateSpaceDescription::sample_t* s : states) {
+            const StateSpaceDescription::sample_t& p = *s;
+            const mesh_map_tree_node_t* p_map = kinematics->node(p.state.map_id);
             //            cslibs_math_3d::Transform3d baseTpred= map->getTranformToBase(p_map->frameId());
             try {
-                const cslibs_math_3d::Transform3d& baseTpred = *transforms.at(p_map->frameId());
-
                 if (p_map && (tau_norm > no_contact_torque_threshold_)) {
+                    const cslibs_math_3d::Transform3d& baseTpred = kinematics->baseTLink(p.state.map_id);
                     if(use_force_threshold_ && (std::fabs(p.state.force) < force_threshold_)){
                         continue;
                     }
@@ -210,7 +211,7 @@ void StatePublisherOffline::publish(const typename sample_set_t::ConstPtr &sampl
     results_.push_back(event);
 
     if(tau_norm > no_contact_torque_threshold_){
-        reportLikelyHoodOfGt(sample_set, gt, map);
+        reportLikelyHoodOfGt(sample_set, gt, map, *kinematics);
     }
 
     set_time_(sample_set->getStamp());
@@ -329,7 +330,8 @@ void StatePublisherOffline::exportResults(const std::string& path)
 
 void StatePublisherOffline::reportLikelyHoodOfGt(const typename sample_set_t::ConstPtr &sample_set,
                                                  const ContactSample& gt,
-                                                 const cslibs_mesh_map::MeshMapTree* map)
+                                                 const cslibs_mesh_map::MeshMapTree* map,
+                                                 const KinematicSnapshot& kinematics)
 {
     if(gt.label == no_collision_label_){
         return;
@@ -340,7 +342,13 @@ void StatePublisherOffline::reportLikelyHoodOfGt(const typename sample_set_t::Co
     cslibs_math_3d::Vector3d true_point;
     cslibs_math_3d::Vector3d true_dir;
     std::string true_point_frame_id = getDiscreteContact(map, gt, true_point, true_dir);
-    cslibs_math_3d::Transform3d b_T_cp = map->getTranformToBase(true_point_frame_id);
+    auto gt_map = map->getNode(true_point_frame_id);
+    if(!gt_map){
+        /// only map nodes are part of the kinematic snapshot
+        throw std::runtime_error("[StatePublisherOffline]: frame_id " + true_point_frame_id + " of label " +
+                                 std::to_string(gt.label) + " is not part of the mesh map!");
+    }
+    const cslibs_math_3d::Transform3d &b_T_cp = kinematics.baseTLink(gt_map->mapId());
     true_point = b_T_cp * true_point;
     true_dir = b_T_cp * true_dir;
 
@@ -350,18 +358,12 @@ void StatePublisherOffline::reportLikelyHoodOfGt(const typename sample_set_t::Co
     d.likely_hood = 0;
     d.contact_force = 0;
     d.contact_force_true = gt.contact_force.norm();
-    d.link = 0;
+    d.link = static_cast<int>(gt_map->mapId());
     d.true_point = gt.label;
-    auto gt_map = map->getNode(true_point_frame_id);
-    if(gt_map){
-        d.link = static_cast<int>(gt_map->mapId());
-    }
     for (const StateSpaceDescription::sample_t& p : sample_set->getSamples()) {
-        const cslibs_mesh_map::MeshMapTreeNode* p_map = map->getNode(p.state.map_id);
+        const cslibs_mesh_map::MeshMapTreeNode* p_map = kinematics.node(p.state.map_id);
         if (p_map) {
-            cslibs_math_3d::Transform3d T = map->getTranformToBase(p_map->map.frame_id_);
-            cslibs_math_3d::Vector3d pos = p.state.getPosition(p_map->map);
-            pos = T * pos;
+            const cslibs_math_3d::Vector3d pos = kinematics.baseTLink(p.state.map_id) * p.state.getPosition(p_map->map);
             double dist = (true_point - pos).length2();
             if(dist < d.distance){
                 cslibs_math_3d::Vector3d dir = p.state.getDirection(p_map->map);
@@ -4,23 +4,28 @@
 
 #include <cslibs_math_ros/tf/conversion_3d.hpp>
 
-TransformGraph::TransformGraph() :
-    tree_(new Node)
+constexpr TransformGraph::id_t TransformGraph::INVALID;
+
+TransformGraph::TransformGraph()
 {
 }
 
 
 bool TransformGraph::setup(const std::vector<tf::StampedTransform> &transforms)
 {
+    ids_.clear();
+    frame_ids_.clear();
+    root_T_frame_.clear();
+
     /// find root
-    std::map<std::string, std::deque<tf::StampedTransform>> transform_map;
+    std::map<std::string, std::deque<const tf::StampedTransform*>> transform_map;
     std::map<std::string, std::size_t> appearance_as_child;
-    std::set<std::string> children;
+    std::map<std::string, const tf::StampedTransform*> last;
 
-    auto add = [&transform_map, &children, &appearance_as_child](const tf::StampedTransform &t){
-        transform_map[t.frame_id_].push_back(t);
+    auto add = [&transform_map, &appearance_as_child, &last](const tf::StampedTransform &t){
+        transform_map[t.frame_id_].push_back(&t);
         ++appearance_as_child[t.child_frame_id_];
-        children.insert(t.child_frame_id_);
+        last[t.child_frame_id_] = &t;
     };
     std::for_each(transforms.begin(), transforms.end(), add);
 
@@ -35,78 +40,83 @@ bool TransformGraph::setup(const std::vector<tf::StampedTransform> &transforms)
         }
     }
 
-    tree_->frame_id = root;
-    std::queue<Node::Ptr> node_queue;
-    node_queue.push(tree_);
+    /// breadth first, so parents always get smaller ids than their children
+    auto insert = [this](const std::string &frame_id, const id_t parent, const transform_t &p_T_f) {
+        const id_t id = frame_ids_.size();
+        ids_[frame_id] = id;
+        frame_ids_.emplace_back(frame_id);
+        root_T_frame_.emplace_back(parent == INVALID ? p_T_f : root_T_frame_[parent] * p_T_f);
+        return id;
+    };
+
+    std::queue<id_t> node_queue;
+    node_queue.push(insert(root, INVALID, transform_t()));
     while(!node_queue.empty()) {
-        Node::Ptr node = node_queue.front();
+        const id_t node = node_queue.front();
         node_queue.pop();
-        std::deque<tf::StampedTransform> children = transform_map[node->frame_id];
-        while(!children.empty()) {
-            tf::StampedTransform ct = children.front();
-            children.pop_front();
-
-            Node::Ptr child_node(new Node);
-            child_node->parent = node;
-            child_node->frame_id = ct.child_frame_id_;
-            child_node->transform_to_parent = cslibs_math_ros::tf::conversion_3d::from<double>(ct);
-            node->children[ct.child_frame_id_] = child_node;
-
-            if(transform_map.find(ct.child_frame_id_) != transform_map.end())
-                node_queue.push(child_node);
+        auto children = transform_map.find(frame_ids_[node]);
+        if(children == transform_map.end())
+            continue;
+        for(const tf::StampedTransform *ct : children->second) {
+            /// a repeated child frame keeps its last transform
+            if(last[ct->child_frame_id_] != ct || ids_.find(ct->child_frame_id_) != ids_.end())
+                continue;
+            node_queue.push(insert(ct->child_frame_id_, node,
+                                   cslibs_math_ros::tf::conversion_3d::from<double>(*ct)));
         }
-        transform_map.erase(node->frame_id);
+        transform_map.erase(children);
     }
 
     return true;
 }
 
-bool TransformGraph::query(const std::string &target, const std::string &source, cslibs_math_3d::Transform3d &t_T_s)
+TransformGraph::id_t TransformGraph::id(const std::string &frame_id) const
 {
-    auto find = [this](const std::string &name)
-    {
-        std::queue<Node::Ptr> node_queue;
-        node_queue.push(tree_);
-        while(!node_queue.empty()) {
-            Node::Ptr node = node_queue.front();
-            node_queue.pop();
-            if(node->frame_id == name)
-                return node;
-            for(auto &c : node->children)
-                node_queue.push(c.second);
-        }
-        return Node::Ptr();
-    };
-
-    auto backtrace = [](const Node::Ptr &n)
-    {
-        Node::Ptr node = n;
-        cslibs_math_3d::Transform3d t;
-        while(node->parent) {
-            t = node->transform_to_parent * t;
-            node = node->parent;
-        }
-        return t;
-    };
+    auto it = ids_.find(frame_id);
+    return it == ids_.end() ? INVALID : it->second;
+}
 
+bool TransformGraph::query(const std::string &target, const std::string &source, transform_t &t_T_s) const
+{
     /// find source
-    Node::Ptr node_src = find(source);
-    if(!node_src) {
+    const id_t src = id(source);
+    if(src == INVALID) {
         std::cerr << "Source not found! \n";
         return false;
     }
 
     /// target
-    Node::Ptr node_tgt = find(target);
-    if(!node_tgt) {
+    const id_t tgt = id(target);
+    if(tgt == INVALID) {
         std::cerr << "Target not found! \n";
         return false;
     }
 
-    cslibs_math_3d::Transform3d r_T_s = backtrace(node_src);
-    cslibs_math_3d::Transform3d r_T_t = backtrace(node_tgt);
+    return query(tgt, src, t_T_s);
+}
 
-    t_T_s = r_T_t.inverse() * r_T_s;
+bool TransformGraph::query(const id_t target, const id_t source, transform_t &t_T_s) const
+{
+    if(target >= frame_ids_.size() || source >= frame_ids_.size())
+        return false;
 
+    t_T_s = root_T_frame_[target].inverse() * root_T_frame_[source];
     return true;
 }
+
+bool TransformGraph::query(const std::vector<std::string> &targets,
+                           const std::vector<std::string> &sources,
+                           transform_vector_t             &t_T_s,
+                           std::vector<uint8_t>           &found) const
+{
+    const std::size_t n = std::min(targets.size(), sources.size());
+    t_T_s.resize(n);
+    found.assign(n, 0);
+
+    bool all = targets.size() == sources.size();
+    for(std::size_t i = 0 ; i < n ; ++i) {
+        found[i] = query(id(targets[i]), id(sources[i]), t_T_s[i]) ? 1 : 0;
+        all &= found[i] != 0;
+    }
+    return all;
+}
@@ -0,0 +1,140 @@
+#include <muse_armcl/update/external_torque_observer_provider.h>
+
+#include <kdl_parser/kdl_parser.hpp>
+
+#include <algorithm>
+
+namespace muse_armcl {
+void ExternalTorqueObserverProvider::doSetup(ros::NodeHandle &nh)
+{
+    auto param_name = [this](const std::string &name){ return name_ + "/" + name; };
+
+    const std::string robot_model = nh.param<std::string>(param_name("robot_description"), "robot_description");
+    const std::string chain_root  = nh.param<std::string>(param_name("chain_root"), "jaco_link_base");
+    const std::string chain_tip   = nh.param<std::string>(param_name("chain_tip"), "jaco_link_hand");
+    const std::vector<double> gravity = nh.param<std::vector<double>>(param_name("gravity"), {0.0, 0.0, -9.81});
+    const std::vector<double> gains   = nh.param<std::vector<double>>(param_name("gains"), {10.0});
+    max_dt_ = nh.param<double>(param_name("max_dt"), 0.1);
+
+    std::string urdf;
+    if (!ros::param::get(robot_model, urdf))
+        throw std::runtime_error("[ExternalTorqueObserverProvider]: Cannot find robot model '" + robot_model + "'!");
+    KDL::Tree tree;
+    if (!kdl_parser::treeFromString(urdf, tree))
+        throw std::runtime_error("[ExternalTorqueObserverProvider]: Cannot parse robot model '" + robot_model + "'!");
+    if (!tree.getChain(chain_root, chain_tip, chain_))
+        throw std::runtime_error("[ExternalTorqueObserverProvider]: No chain from " + chain_root + " to " + chain_tip + "!");
+    if (gravity.size() != 3 || gains.empty())
+        throw std::runtime_error("[ExternalTorqueObserverProvider]: gravity needs 3 values and gains at least one!");
+
+    dynamics_.reset(new KDL::ChainDynParam(chain_, KDL::Vector(gravity[0], gravity[1], gravity[2])));
+
+    /// one gain per joint, the last gain is used for the remaining joints
+    const std::size_t n = chain_.getNrOfJoints();
+    gains_.resize(n);
+    for (std::size_t i = 0 ; i < n ; ++i)
+        gains_(i) = gains[std::min(i, gains.size() - 1)];
+
+    q_.resize(n);
+    qd_.resize(n);
+    tau_.resize(n);
+    coriolis_.resize(n);
+    gravity_.resize(n);
+    mass_.resize(n);
+    integral_.setZero(n);
+    p0_.setZero(n);
+    residual_.setZero(n);
+    last_mass_.setZero(n, n);
+    initialized_ = false;
+    chain_index_.clear();
+    chain_version_ = 0;
+
+    JointStateProvider::doSetup(nh);
+}
+
+bool ExternalTorqueObserverProvider::process(JointStateData &data)
+{
+    /// the provider may resolve its output names again at runtime, which invalidates the chain indices
+    if (chain_index_.empty() || chain_version_ != mapping_version_) {
+        if (!resolveChain(data))
+            return false;
+        chain_version_ = mapping_version_;
+        initialized_ = false;
+    }
+
+    const std::size_t n = chain_.getNrOfJoints();
+    if (data.velocity.size() != data.position.size() || data.effort.size() != data.position.size()) {
+        ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: joint states need positions, velocities and measured torques.");
+        return false;
+    }
+    for (std::size_t i = 0 ; i < n ; ++i) {
+        const int j = chain_index_[i];
+        if (j < 0 || static_cast<std::size_t>(j) >= data.position.size()) {
+            ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: joint state index " << j << " of chain joint "
+                                     << i << " is out of range, dropping the joint state.");
+            chain_index_.clear();
+            return false;
+        }
+        q_(i)   = data.position[j];
+        qd_(i)  = data.velocity[j];
+        tau_(i) = data.effort[j];
+    }
+
+    dynamics_->JntToMass(q_, mass_);
+    dynamics_->JntToCoriolis(q_, qd_, coriolis_);
+    dynamics_->JntToGravity(q_, gravity_);
+
+    const cslibs_time::Time stamp = data.timeFrame().end;
+    const double dt = initialized_ ? (stamp - last_stamp_).seconds() : 0.0;
+    if (!initialized_ || dt <= 0.0 || dt > max_dt_) {
+        /// (re)start the observer, a gap in the data invalidates the integral
+        if (initialized_)
+            ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: time step of " << dt << "s, restarting the observer.");
+        reset();
+        p0_ = mass_.data * qd_.data;
+        last_mass_ = mass_.data;
+        last_stamp_ = stamp;
+        initialized_ = true;
+    } else {
+        /// r = K (M qd - p0 - int(tau + C^T qd - g + r)), C^T qd = dM/dt qd - C qd
+        const Eigen::VectorXd ct_qd = ((mass_.data - last_mass_) / dt) * qd_.data - coriolis_.data;
+        integral_ += (tau_.data + ct_qd - gravity_.data + residual_) * dt;
+        residual_ = gains_.cwiseProduct(mass_.data * qd_.data - p0_ - integral_);
+        last_mass_ = mass_.data;
+        last_stamp_ = stamp;
+    }
+
+    /// the update model expects the external torques of the chain joints in the effort field
+    data.effort.resize(n);
+    for (std::size_t i = 0 ; i < n ; ++i)
+        data.effort[i] = residual_(i);
+    return true;
+}
+
+bool ExternalTorqueObserverProvider::resolveChain(const JointStateData &data)
+{
+    chain_index_.clear();
+    for (const KDL::Segment &segment : chain_.segments) {
+        if (segment.getJoint().getType() == KDL::Joint::None)
+            continue;
+        const std::string &joint = segment.getJoint().getName();
+        auto it = std::find(data.name.begin(), data.name.end(), joint);
+        if (it == data.name.end()) {
+            ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: joint '" << joint << "' is not part of the joint states.");
+            chain_index_.clear();
+            return false;
+        }
+        chain_index_.emplace_back(static_cast<int>(it - data.name.begin()));
+    }
+    return true;
+}
+
+void ExternalTorqueObserverProvider::reset()
+{
+    integral_.setZero();
+    residual_.setZero();
+}
+}
+
+#include <class_loader/class_loader_register_macro.h>
+CLASS_LOADER_REGISTER_CLASS(muse_armcl::ExternalTorqueObserverProvider, cslibs_plugins_data::DataProvider)
@@ -1,32 +1,128 @@
 #include <muse_armcl/update/joint_state_provider.h>
 
+#include <algorithm>
+#include <atomic>
+
 namespace muse_armcl {
 void JointStateProvider::callback(const sensor_msgs::JointStateConstPtr &msg)
 {
+    /// the mapping is resolved once per message layout, afterwards only numbers are copied
+    if (!resolved_ || msg->name != msg_names_) {
+        if (resolved_)
+            ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: joint names of the joint states changed, resolving the mapping again.");
+        resolve(*msg);
+    }
+
+    JointStateData::Ptr data = acquire();
+    if (!data) {
+        if (!slots_.empty())
+            ROS_WARN_STREAM_THROTTLE(1.0, "[" << name_ << "]: all " << slots_.size()
+                                     << " joint state slots in use, consider raising buffer_size.");
+        data.reset(new JointStateData(names_));
+    }
+
+    const auto &nsec = msg->header.stamp.toNSec();
+    const cslibs_time::Time stamp(nsec);
+    const cslibs_time::Time received = clock_.now(stamp);
+    data->reset(msg->header.frame_id,
+                cslibs_time::TimeFrame(nsec, nsec),
+                received < stamp ? stamp : received);
+    copy(msg->position, data->position);
+    copy(msg->velocity, data->velocity);
+    copy(msg->effort,   data->effort);
+    /// stateful processing sees every message, only the handoff to the filter is throttled
+    if (!process(*data))
+        return;
     if (!time_offset_.isZero() && !time_of_last_measurement_.isZero())
         if (msg->header.stamp <= (time_of_last_measurement_ + time_offset_))
             return;
-
-    const auto &nsec = msg->header.stamp.toNSec();
-    JointStateData::Ptr data(new JointStateData(msg->header.frame_id,
-                                                cslibs_time::TimeFrame(nsec, nsec),
-                                                cslibs_time::Time(std::max(nsec, ros::Time::now().toNSec())),
-                                                msg->name,
-                                                msg->position,
-                                                msg->velocity,
-                                                msg->effort));
+    data->sequence = ++arrivals_->count;
+    data->arrivals = arrivals_;
 
     data_received_(data);
     time_of_last_measurement_ = msg->header.stamp;
 }
 
+bool JointStateProvider::process(JointStateData &data)
+{
+    return true;
+}
+
+void JointStateProvider::resolve(const sensor_msgs::JointState &msg)
+{
+    msg_names_ = msg.name;
+    const std::vector<std::string> &names = joint_names_.empty() ? msg.name : joint_names_;
+
+    if (names.empty()) {
+        /// unnamed joint states keep the message order
+        index_.resize(msg.position.size());
+        for (std::size_t i = 0 ; i < index_.size() ; ++i)
+            index_[i] = static_cast<int>(i);
+    } else {
+        index_.assign(names.size(), -1);
+    }
+    for (std::size_t i = 0 ; i < names.size() ; ++i) {
+        auto it = std::find(msg.name.begin(), msg.name.end(), names[i]);
+        if (it != msg.name.end())
+            index_[i] = static_cast<int>(it - msg.name.begin());
+        else
+            ROS_WARN_STREAM("[" << name_ << "]: joint '" << names[i] << "' is not part of the joint states, using 0.");
+    }
+
+    /// the slots carry the output names, configured joint names keep them across layouts
+    if (!resolved_ || names != names_) {
+        names_ = names;
+        slots_.clear();
+        for (std::size_t i = 0 ; i < buffer_size_ ; ++i)
+            slots_.emplace_back(new JointStateData(names_));
+        next_slot_ = 0;
+    }
+    resolved_ = true;
+    ++mapping_version_;
+}
+
+JointStateData::Ptr JointStateProvider::acquire()
+{
+    /// only the provider holds a free slot, so nobody can take a new reference concurrently
+    for (std::size_t i = 0 ; i < slots_.size() ; ++i) {
+        JointStateData::Ptr &slot = slots_[next_slot_];
+        next_slot_ = (next_slot_ + 1) % slots_.size();
+        if (slot.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot;
+        }
+    }
+    return nullptr;
+}
+
+void JointStateProvider::copy(const std::vector<double> &src, std::vector<double> &dst) const
+{
+    /// unused fields stay empty like in the message
+    if (src.empty()) {
+        dst.clear();
+        return;
+    }
+    dst.resize(index_.size());
+    for (std::size_t i = 0 ; i < index_.size() ; ++i) {
+        const int j = index_[i];
+        dst[i] = (j >= 0 && static_cast<std::size_t>(j) < src.size()) ? src[j] : 0.0;
+    }
+}
+
 void JointStateProvider::doSetup(ros::NodeHandle &nh)
 {
     auto param_name = [this](const std::string &name){ return name_ + "/" + name; };
 
+    arrivals_.reset(new JointStateData::Arrivals);
+    buffer_size_    = static_cast<std::size_t>(std::max(0, nh.param<int>(param_name("buffer_size"), 16)));
+    joint_names_    = nh.param<std::vector<std::string>>(param_name("joint_names"), std::vector<std::string>());
+    next_slot_      = 0;
+    resolved_       = false;
+    mapping_version_ = 0;
     int queue_size  = nh.param<int>(param_name("queue_size"), 1);
     topic_          = nh.param<std::string>(param_name("topic"), "");
     source_         = nh.subscribe(topic_, queue_size, &JointStateProvider::callback, this);
+    clock_.setup(nh);
 
     double rate     = nh.param<double>(param_name("rate"), 0.0);
     if (rate > 0.0) {
@@ -41,15 +41,13 @@ public:
 
     virtual double calculateWeight(const state_t& state,
                                    const Eigen::VectorXd &tau_ext_sensed,
-                                   const cslibs_mesh_map::MeshMapTree *maps,
-                                   const std::map<std::size_t, Eigen::MatrixXd>& jacobian,
-                                   const std::map<std::size_t, KDL::Frame>& transforms) override
+                                   const KinematicSnapshot& kinematics) override
     {
-        const cslibs_mesh_map::MeshMapTreeNode* particle_map = maps->getNode(state.map_id);
+        const cslibs_mesh_map::MeshMapTreeNode* particle_map = kinematics.node(state.map_id);
         const cslibs_mesh_map::MeshMap& map = particle_map->map;
-        std::string frame_id = map.frame_id_;
-        cslibs_math_3d::Vector3d pos = state.getPosition(map);
-        cslibs_math_3d::Vector3d normal = state.getNormal(map);
+        const std::string &frame_id = map.frame_id_;
+        cslibs_math_3d::Vector3d pos, normal;
+        surface(state, map, pos, normal);
         KDL::Vector n(normal(0), normal(1), normal(2));
         KDL::Vector p(pos(0), pos(1), pos(2));
 
@@ -57,10 +55,10 @@ public:
         KDL::Vector axis = z * n;
         double alpha = std::acos(dot(z, n));
         tranform_ = KDL::Frame(KDL::Rotation::Rot(axis, alpha), p);
-        jacobian_ = &jacobian.at(state.map_id);
+        jacobian_ = &kinematics.jacobian(state.map_id);
 
         if(frame_id.find("finger") != std::string::npos ){
-            tranform_ = transforms.at(state.map_id) *  tranform_;
+            tranform_ = kinematics.linkFrame(state.map_id) *  tranform_;
         }
 
         std::size_t rows = jacobian_->cols();
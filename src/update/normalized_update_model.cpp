@@ -13,34 +13,27 @@ public:
     using allocator_t = Eigen::aligned_allocator<NormalizedUpdateModel>;
     virtual double calculateWeight(const state_t&state,
                                    const Eigen::VectorXd &tau_ext_sensed,
-                                   const cslibs_mesh_map::MeshMapTree *maps,
-                                   const std::map<std::size_t, Eigen::MatrixXd>& jacobian,
-                                   const std::map<std::size_t, KDL::Frame>& transforms) override
+                                   const KinematicSnapshot& kinematics) override
     {
-        const cslibs_mesh_map::MeshMapTreeNode* particle_map = maps->getNode(state.map_id);
+        const cslibs_mesh_map::MeshMapTreeNode* particle_map = kinematics.node(state.map_id);
         const cslibs_mesh_map::MeshMap& map = particle_map->map;
-        std::string frame_id = map.frame_id_;
-        cslibs_math_3d::Vector3d pos = state.getPosition(map);
-        cslibs_math_3d::Vector3d normal = state.getNormal(map);
+        const std::string &frame_id = map.frame_id_;
+        cslibs_math_3d::Vector3d pos, normal;
+        surface(state, map, pos, normal);
         KDL::Vector n(normal(0), normal(1), normal(2));
         KDL::Vector p(pos(0), pos(1), pos(2));
         KDL::Wrench w = cslibs_kdl::ExternalForcesSerialChain::createWrench(p, n);
 
 //        Eigen::VectorXd tau_particle_local = model_.getExternalTorques(joint_state.position, frame_id, w);
         if(frame_id.find("finger") != std::string::npos ){
-            try {
-                w = transforms.at(state.map_id) *  w;
-            } catch (const std::exception &e) {
-                std::cerr << "[UpdateModel] : looked for finger..." << std::endl;
-                throw e;
-            }
+            w = kinematics.linkFrame(state.map_id) *  w;
         }
         Eigen::VectorXd F = cslibs_kdl::convert2Eigen(w);
         Eigen::VectorXd tau_particle(Eigen::VectorXd::Zero(n_joints_));
 
 
         try {
-            const Eigen::MatrixXd &j = jacobian.at(state.map_id);
+            const Eigen::MatrixXd &j = kinematics.jacobian(state.map_id);
             if(j.cols() != F.rows()) {
                 std::cerr << "[UpdateModel]: cannot multiply j * F" << std::endl;
             }